@@ -0,0 +1,54 @@
+#include "arena.h"
+
+static uint8_t g_frameArenaMemory[FRAME_ARENA_SIZE]
+    __attribute__((aligned(FRAME_ARENA_ALIGN)));
+
+FrameArena g_frameArena = {
+    .base = g_frameArenaMemory,
+    .size = FRAME_ARENA_SIZE,
+};
+
+FrameArena FrameArenaConstruct(void *memory, size_t size)
+{
+    FrameArena arena = {0};
+    const uintptr_t start = ((uintptr_t) memory + FRAME_ARENA_ALIGN - 1) &
+                            ~(uintptr_t) (FRAME_ARENA_ALIGN - 1);
+    const size_t skipped = start - (uintptr_t) memory;
+    if (size > skipped) {
+        arena.base = (uint8_t *) start;
+        arena.size = size - skipped;
+    }
+    return arena;
+}
+
+void *FrameArenaAlloc(FrameArena *arena, size_t size)
+{
+    const size_t start = (arena->used + FRAME_ARENA_ALIGN - 1) &
+                         ~(size_t) (FRAME_ARENA_ALIGN - 1);
+    if (size == 0 || start > arena->size || size > arena->size - start) {
+        arena->failures++;
+        return NULL;
+    }
+    arena->used = start + size;
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+        if (arena->peak > arena->highWater) {
+            arena->highWater = arena->peak;
+        }
+    }
+    return arena->base + start;
+}
+
+void FrameArenaRelease(FrameArena *arena, size_t mark)
+{
+    if (mark < arena->used) {
+        arena->used = mark;
+    }
+}
+
+void FrameArenaReset(FrameArena *arena)
+{
+    arena->lastFrame = arena->peak;
+    arena->peak = 0;
+    arena->used = 0;
+}
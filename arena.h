@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// size of the shared per-frame arena
+#ifndef FRAME_ARENA_SIZE
+#define FRAME_ARENA_SIZE (64 * 1024)
+#endif
+
+// allocations start on a cache line, so a buffer handed to a device can be
+// cleaned and invalidated without touching its neighbours
+#define FRAME_ARENA_ALIGN 32
+
+// Bump allocator for scratch memory that only lives until the end of the
+// frame. Nothing is freed individually; FrameArenaReset drops everything.
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    // most bytes in use during this frame, the last finished one and any
+    // frame so far
+    size_t peak;
+    size_t lastFrame;
+    size_t highWater;
+    // allocations that did not fit since construction
+    uint32_t failures;
+} FrameArena;
+
+// arena reset once per frame by the main loop
+extern FrameArena g_frameArena;
+
+FrameArena FrameArenaConstruct(void *memory, size_t size);
+
+// Returns FRAME_ARENA_ALIGN aligned memory, or NULL when the arena is full.
+void *FrameArenaAlloc(FrameArena *arena, size_t size);
+
+// Marks let a caller give back what it allocated before the frame ends.
+static inline size_t FrameArenaMark(const FrameArena *arena)
+{
+    return arena->used;
+}
+
+void FrameArenaRelease(FrameArena *arena, size_t mark);
+
+// Ends a frame: records its usage and frees everything.
+void FrameArenaReset(FrameArena *arena);
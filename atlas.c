@@ -0,0 +1,54 @@
+#include "atlas.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool TextureAtlasOpen(TextureAtlas *atlas, const char *path, uint16_t levels)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(AtlasHeader)) {
+        close(fd);
+        return false;
+    }
+    void *mapping =
+        mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    const AtlasHeader *header = (const AtlasHeader *) mapping;
+    const size_t texels = (size_t) header->textures * 2 * levels * 4096;
+    if (header->magic != ATLAS_MAGIC || header->version != ATLAS_VERSION ||
+        header->size != 64 || header->levels != levels ||
+        header->textures == 0 || header->offset < sizeof(AtlasHeader) ||
+        header->offset % sizeof(uint32_t) != 0 ||
+        (size_t) st.st_size < header->offset + texels * sizeof(uint32_t)) {
+        munmap(mapping, (size_t) st.st_size);
+        return false;
+    }
+
+    atlas->texels =
+        (const uint32_t *) ((const uint8_t *) mapping + header->offset);
+    atlas->textures = header->textures;
+    atlas->mapping = mapping;
+    atlas->length = (size_t) st.st_size;
+    return true;
+}
+
+void TextureAtlasClose(TextureAtlas *atlas)
+{
+    if (atlas->mapping != NULL) {
+        munmap(atlas->mapping, atlas->length);
+    }
+    atlas->texels = NULL;
+    atlas->textures = 0;
+    atlas->mapping = NULL;
+    atlas->length = 0;
+}
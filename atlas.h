@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ATLAS_MAGIC 0x41544352 // "RCTA"
+#define ATLAS_VERSION 1
+// texels start on their own page so that mapping them needs no copy
+#define ATLAS_TEXELS_OFFSET 4096
+
+// On-disk header of a texture atlas, host byte order. The texels that
+// follow are already in the renderer's layout: for every texture both
+// wall sides, each side as `levels` shade variants of a 64x64 ABGR8888
+// image stored row after row, ie. uint32_t[textures][2][levels][4096].
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t textures;
+    uint16_t size;
+    uint16_t levels;
+    uint32_t offset;
+} AtlasHeader;
+
+typedef struct {
+    const uint32_t *texels;
+    uint16_t textures;
+    void *mapping;
+    size_t length;
+} TextureAtlas;
+
+// Maps an atlas file read-only. Nothing is read beyond the header, texel
+// pages are only faulted in once the renderer samples them.
+bool TextureAtlasOpen(TextureAtlas *atlas, const char *path, uint16_t levels);
+
+void TextureAtlasClose(TextureAtlas *atlas);
@@ -0,0 +1,40 @@
+#include "capture.h"
+
+#include <string.h>
+
+#include "uart.h"
+
+void capture_send(const uint32_t *pixels,
+                  uint16_t width,
+                  uint16_t height,
+                  uint16_t playerX,
+                  uint16_t playerY,
+                  int16_t playerA,
+                  uint8_t flags)
+{
+    const uint32_t count = (uint32_t) width * height;
+    CaptureHeader header;
+    memcpy(header.magic, CAPTURE_MAGIC, 4);
+    header.width = width;
+    header.height = height;
+    header.playerX = playerX;
+    header.playerY = playerY;
+    header.playerA = playerA;
+    header.flags = flags;
+    header.reserved = 0;
+    header.hash = capture_hash(pixels, count);
+    uart_write(&header, sizeof(header));
+
+    // ceiling and floor rows and wall slices repeat a lot, walls along rows
+    // less so; runs keep the transfer to a fraction of the raw frame
+    for (uint32_t i = 0; i < count;) {
+        const uint32_t pixel = pixels[i];
+        uint8_t run = 1;
+        while (i + run < count && run < 255 && pixels[i + run] == pixel) {
+            ++run;
+        }
+        uart_putc(run);
+        uart_write(&pixel, sizeof(pixel));
+        i += run;
+    }
+}
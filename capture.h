@@ -0,0 +1,47 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+// A rendered frame as sent over the UART: this header, then (count, pixel)
+// runs of one count byte and a 32-bit pixel until width * height pixels are
+// covered. The magic lets a reader find it between text output, the hash of
+// the decoded pixels rejects false matches and transfer errors.
+#define CAPTURE_MAGIC "RCFB"
+
+#define CAPTURE_FLATS 1
+#define CAPTURE_LIGHTING 2
+
+typedef struct {
+    char magic[4];
+    uint16_t width;
+    uint16_t height;
+    // view the frame was traced from
+    uint16_t playerX;
+    uint16_t playerY;
+    int16_t playerA;
+    uint8_t flags;
+    uint8_t reserved;
+    // FNV-1a over the pixels
+    uint32_t hash;
+} __attribute__((packed)) CaptureHeader;
+
+static inline uint32_t capture_hash(const uint32_t *pixels, uint32_t count)
+{
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < count; ++i) {
+        hash = (hash ^ pixels[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Sends a width x height buffer traced from the given view over the UART.
+void capture_send(const uint32_t *pixels,
+                  uint16_t width,
+                  uint16_t height,
+                  uint16_t playerX,
+                  uint16_t playerY,
+                  int16_t playerA,
+                  uint8_t flags);
+
+#endif  // CAPTURE_H
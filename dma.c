@@ -0,0 +1,92 @@
+#include "dma.h"
+
+#include "mmio.h"
+#include "mmu.h"
+
+#define DMA_BASE 0x20007000
+#define DMA_CHANNEL(n) (DMA_BASE + (n) * 0x100)
+#define DMA_CS(n) (DMA_CHANNEL(n) + 0x00)
+#define DMA_CONBLK_AD(n) (DMA_CHANNEL(n) + 0x04)
+#define DMA_ENABLE (DMA_BASE + 0xFF0)
+
+#define DMA_CS_ACTIVE (1 << 0)
+#define DMA_CS_END (1 << 1)
+#define DMA_CS_INT (1 << 2)
+#define DMA_CS_ERROR (1 << 8)
+#define DMA_CS_PRIORITY(n) ((n) << 16)
+#define DMA_CS_PANIC_PRIORITY(n) ((n) << 20)
+#define DMA_CS_WAIT_FOR_WRITES (1 << 28)
+#define DMA_CS_RESET (1u << 31)
+
+#define DMA_TI_WAIT_RESP (1 << 3)
+#define DMA_TI_DEST_INC (1 << 4)
+#define DMA_TI_DEST_WIDTH (1 << 5)
+#define DMA_TI_SRC_INC (1 << 8)
+#define DMA_TI_SRC_WIDTH (1 << 9)
+#define DMA_TI_BURST_LENGTH(n) ((n) << 12)
+
+// the L2-coherent alias of RAM on the VideoCore bus
+#define DMA_BUS_RAM 0x40000000
+
+void dma_init(uint32_t channel)
+{
+    mmio_write(DMA_ENABLE, mmio_read(DMA_ENABLE) | (1 << channel));
+    mmio_write(DMA_CS(channel), DMA_CS_RESET);
+    while (mmio_read(DMA_CS(channel)) & DMA_CS_RESET)
+        ;
+}
+
+uint32_t dma_bus_address(const void *ptr)
+{
+    return ((uint32_t) (uintptr_t) ptr & 0x3FFFFFFF) | DMA_BUS_RAM;
+}
+
+void dma_copy_block(DmaControlBlock *block,
+                    void *dest,
+                    const void *source,
+                    uint32_t size)
+{
+    // 128-bit reads and writes in bursts of four
+    block->ti = DMA_TI_SRC_INC | DMA_TI_SRC_WIDTH | DMA_TI_DEST_INC |
+                DMA_TI_DEST_WIDTH | DMA_TI_WAIT_RESP | DMA_TI_BURST_LENGTH(4);
+    block->source = dma_bus_address(source);
+    block->dest = dma_bus_address(dest);
+    block->length = size;
+    block->stride = 0;
+    block->next = 0;
+    block->reserved[0] = 0;
+    block->reserved[1] = 0;
+}
+
+void dma_chain(DmaControlBlock *block, const DmaControlBlock *next)
+{
+    block->next = next ? dma_bus_address(next) : 0;
+}
+
+void dma_start(uint32_t channel, const DmaControlBlock *first, uint32_t count)
+{
+    cache_clean_range(first, count * sizeof(DmaControlBlock));
+    dma_wait(channel);
+    // clear the end and interrupt flags of the last run
+    mmio_write(DMA_CS(channel), DMA_CS_END | DMA_CS_INT);
+    mmio_write(DMA_CONBLK_AD(channel), dma_bus_address(first));
+    mmio_write(DMA_CS(channel), DMA_CS_ACTIVE | DMA_CS_WAIT_FOR_WRITES |
+                                    DMA_CS_PRIORITY(8) |
+                                    DMA_CS_PANIC_PRIORITY(15));
+}
+
+bool dma_busy(uint32_t channel)
+{
+    return mmio_read(DMA_CS(channel)) & DMA_CS_ACTIVE;
+}
+
+void dma_wait(uint32_t channel)
+{
+    while (dma_busy(channel)) {
+        if (mmio_read(DMA_CS(channel)) & DMA_CS_ERROR) {
+            // a bus error stalls the channel, drop the rest of the chain
+            mmio_write(DMA_CS(channel), DMA_CS_RESET);
+            break;
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// channel left to the ARM by the firmware
+#define DMA_BLIT_CHANNEL 0
+
+// Control block as the DMA engine reads it. Blocks are chained through next
+// and have to sit on a 32-byte boundary.
+typedef struct {
+    uint32_t ti;
+    uint32_t source;
+    uint32_t dest;
+    uint32_t length;
+    uint32_t stride;
+    uint32_t next;
+    uint32_t reserved[2];
+} __attribute__((aligned(32))) DmaControlBlock;
+
+// Enables and resets a channel.
+void dma_init(uint32_t channel);
+
+// Address the DMA engine sees for an ARM pointer into RAM.
+uint32_t dma_bus_address(const void *ptr);
+
+// Fills a block copying size bytes, with size a multiple of 16. The block is
+// the end of a chain until dma_chain links it.
+void dma_copy_block(DmaControlBlock *block,
+                    void *dest,
+                    const void *source,
+                    uint32_t size);
+
+// Makes the engine continue with next after block.
+void dma_chain(DmaControlBlock *block, const DmaControlBlock *next);
+
+// Runs a chain of count contiguous blocks starting at first. The blocks are
+// written back from the data cache; the source data has to be clean already.
+void dma_start(uint32_t channel, const DmaControlBlock *first, uint32_t count);
+
+bool dma_busy(uint32_t channel);
+
+void dma_wait(uint32_t channel);
+
+#endif  // DMA_H
@@ -4,21 +4,29 @@
 
 #include "mailbox.h"
 
-void *fb_create(uint32_t width, uint32_t height, uint32_t depth)
+bool fb_create(Framebuffer *fb,
+               uint32_t width,
+               uint32_t height,
+               uint32_t depth)
 {
-    PropertyMessageTag tags[4];
+    PropertyMessageTag tags[5];
     tags[0].tag = FB_SET_PHYSICAL_SIZE;
     tags[0].value.fbScreenSize.width = width;
     tags[0].value.fbScreenSize.height = height;
     tags[1].tag = FB_SET_VIRTUAL_SIZE;
     tags[1].value.fbScreenSize.width = width;
-    tags[1].value.fbScreenSize.height = height;
+    tags[1].value.fbScreenSize.height = height * 2;
     tags[2].tag = FB_SET_DEPTH;
     tags[2].value.fbBitsPerPixel = depth;
-    tags[3].tag = NULL_TAG;
+    tags[3].tag = FB_SET_VIRTUAL_OFFSET;
+    tags[3].value.fbVirtualOffset.x = 0;
+    tags[3].value.fbVirtualOffset.y = 0;
+    tags[4].tag = NULL_TAG;
     if (mailbox_send_messages(tags) != 0) {
-        return NULL;
+        return false;
     }
+    // the firmware answers with the size it actually set up
+    fb->flipping = tags[1].value.fbScreenSize.height >= height * 2;
 
     tags[0].tag = FB_ALLOCATE_TAG;
     tags[0].value.fbScreenSize.width = 0;
@@ -26,39 +34,51 @@ void *fb_create(uint32_t width, uint32_t height, uint32_t depth)
     tags[0].value.fbAllocateAlignment = 16;
     tags[1].tag = NULL_TAG;
     if (mailbox_send_messages(tags) != 0) {
-        return NULL;
+        return false;
     }
 
-    return (void *) tags[0].value.fbAllocateRes.base;
+    // the GPU hands out a bus address, strip the alias bits for the ARM
+    const uint32_t base = tags[0].value.fbAllocateRes.base & 0x3FFFFFFF;
+    fb->base = (uint32_t *) (uintptr_t) base;
+    fb->width = width;
+    fb->height = height;
+    fb->size = tags[0].value.fbAllocateRes.size;
+    // page 0 is on screen
+    fb->back = fb->flipping ? 1 : 0;
+    return true;
 }
 
-void fb_putc(uint32_t *fb,
-             int width,
-             int height,
-             const uint8_t *font,
-             int x,
-             int y)
+uint32_t *fb_back_buffer(const Framebuffer *fb)
 {
-    (void) height;
+    return fb->base + fb->back * fb->width * fb->height;
+}
 
-    for (int j = 0; j < 16; ++j) {
-        for (int i = 0; i < 8; ++i) {
-            if (font[j] & (1 << i)) {
-                fb[(y + j) * width + (x + i)] = 0xFFFFFFFF;
-            }
-        }
-    }
+// The firmware answers once the next vertical sync has passed.
+static void fb_wait_for_vsync(void)
+{
+    PropertyMessageTag tags[2];
+    tags[0].tag = FB_WAIT_FOR_VSYNC;
+    tags[0].value.fbVsync = 0;
+    tags[1].tag = NULL_TAG;
+    mailbox_send_messages(tags);
 }
 
-void fb_puts(uint32_t *fb,
-             int width,
-             int height,
-             const uint8_t (*font)[16],
-             const char *str,
-             int x,
-             int y)
+void fb_flip(Framebuffer *fb)
 {
-    for (int i = 0; str[i] != '\0'; ++i) {
-        fb_putc(fb, width, height, font[(uint8_t) str[i]], x + 8 * i, y);
+    if (!fb->flipping) {
+        return;
     }
-}
\ No newline at end of file
+    PropertyMessageTag tags[2];
+    tags[0].tag = FB_SET_VIRTUAL_OFFSET;
+    tags[0].value.fbVirtualOffset.x = 0;
+    tags[0].value.fbVirtualOffset.y = fb->back * fb->height;
+    tags[1].tag = NULL_TAG;
+    if (mailbox_send_messages(tags) != 0) {
+        return;
+    }
+    // the new offset is only latched at the next vertical sync, until then
+    // the old front page is still being scanned out; a separate message so
+    // firmware without the tag still flips, just with tearing
+    fb_wait_for_vsync();
+    fb->back ^= 1;
+}
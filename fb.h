@@ -1,23 +1,35 @@
 #ifndef FB_H
 #define FB_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
-void *fb_create(uint32_t width, uint32_t height, uint32_t depth);
+// A framebuffer twice as tall as the screen, so one page can be drawn while
+// the other is shown.
+typedef struct {
+    uint32_t *base;
+    uint32_t width;
+    uint32_t height;
+    // bytes of both pages
+    uint32_t size;
+    // page not on screen, 0 or 1
+    uint32_t back;
+    // false when the firmware refused the second page, then the only page
+    // is drawn while it is shown
+    bool flipping;
+} Framebuffer;
 
-void fb_putc(uint32_t *fb,
-             int width,
-             int height,
-             const uint8_t *font,
-             int x,
-             int y);
+bool fb_create(Framebuffer *fb,
+               uint32_t width,
+               uint32_t height,
+               uint32_t depth);
 
-void fb_puts(uint32_t *fb,
-             int width,
-             int height,
-             const uint8_t (*font)[16],
-             const char *str,
-             int x,
-             int y);
+// Page to draw the next frame into.
+uint32_t *fb_back_buffer(const Framebuffer *fb);
 
-#endif  // FB_H
\ No newline at end of file
+// Shows the back page by moving the virtual offset onto it, and returns once
+// the display has switched over, so the old front page is free to draw into.
+// Blocks for up to a frame.
+void fb_flip(Framebuffer *fb);
+
+#endif  // FB_H
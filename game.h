@@ -2,11 +2,18 @@
 
 #include <stdint.h>
 
+#include "map.h"
+
 typedef struct {
+    const Map *map;
     uint16_t playerX, playerY;
     int16_t playerA;
 } Game;
 
-Game GameConstruct(void);
+// Places the player at the first spawn point of the map.
+Game GameConstruct(const Map *map);
+
+// sine and cosine of the view angle, scaled by 256
+void GameDirection(const Game *game, int16_t *sine, int16_t *cosine);
 
 void GameMove(Game *game, int m, int r, uint16_t seconds);
@@ -0,0 +1,62 @@
+#include "irq.h"
+
+#include <stddef.h>
+
+#include "mmio.h"
+
+#define IRQ_BASE 0x2000B200
+#define IRQ_PENDING1 (IRQ_BASE + 0x04)
+#define IRQ_PENDING2 (IRQ_BASE + 0x08)
+#define IRQ_ENABLE1 (IRQ_BASE + 0x10)
+#define IRQ_ENABLE2 (IRQ_BASE + 0x14)
+#define IRQ_DISABLE1 (IRQ_BASE + 0x1C)
+#define IRQ_DISABLE2 (IRQ_BASE + 0x20)
+#define IRQ_DISABLE_BASIC (IRQ_BASE + 0x24)
+
+#define IRQ_COUNT 64
+
+extern uint32_t vector_table[];
+
+static IrqHandler g_irqHandlers[IRQ_COUNT];
+
+void irq_init(void)
+{
+    mmio_write(IRQ_DISABLE1, 0xFFFFFFFF);
+    mmio_write(IRQ_DISABLE2, 0xFFFFFFFF);
+    mmio_write(IRQ_DISABLE_BASIC, 0xFFFFFFFF);
+
+    // VBAR, the ARM1176 has the security extensions
+    __asm__ volatile("mcr p15, 0, %0, c12, c0, 0" ::"r"(vector_table)
+                     : "memory");
+    __asm__ volatile("cpsie i" ::: "memory");
+}
+
+void irq_enable(uint32_t irq, IrqHandler handler)
+{
+    if (irq >= IRQ_COUNT) {
+        return;
+    }
+    g_irqHandlers[irq] = handler;
+    if (irq < 32) {
+        mmio_write(IRQ_ENABLE1, 1u << irq);
+    } else {
+        mmio_write(IRQ_ENABLE2, 1u << (irq - 32));
+    }
+}
+
+static void irq_dispatch(uint32_t pending, uint32_t first)
+{
+    while (pending) {
+        const uint32_t bit = __builtin_ctz(pending);
+        pending &= pending - 1;
+        if (g_irqHandlers[first + bit] != NULL) {
+            g_irqHandlers[first + bit]();
+        }
+    }
+}
+
+void irq_handler(void)
+{
+    irq_dispatch(mmio_read(IRQ_PENDING1), 0);
+    irq_dispatch(mmio_read(IRQ_PENDING2), 32);
+}
@@ -0,0 +1,21 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdint.h>
+
+// interrupt numbers of the BCM2835 interrupt controller
+#define IRQ_UART 57
+
+typedef void (*IrqHandler)(void);
+
+// Installs the vector table, masks every interrupt source and unmasks IRQs
+// in the CPU. Call before any driver enables its interrupt.
+void irq_init(void);
+
+// Routes an interrupt to handler and unmasks it.
+void irq_enable(uint32_t irq, IrqHandler handler);
+
+// Called from the IRQ vector.
+void irq_handler(void);
+
+#endif  // IRQ_H
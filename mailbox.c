@@ -1,9 +1,12 @@
 #include "mailbox.h"
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "mmio.h"
+#include "mmu.h"
 
 #define MAILBOX_BASE 0x2000B880
 #define MAILBOX_READ (MAILBOX_BASE + 0x00)
@@ -51,26 +54,55 @@ uint32_t get_value_buffer_size(uint32_t tag)
     switch (tag) {
     case CLOCK_SET_RATE:
         return 12;
+    case GET_ARM_MEMORY:
     case FB_ALLOCATE_TAG:
     case FB_SET_PHYSICAL_SIZE:
     case FB_SET_VIRTUAL_SIZE:
+    case FB_SET_VIRTUAL_OFFSET:
+    case CLOCK_GET_RATE:
     case CLOCK_GET_MAX_RATE:
+    case GET_TEMPERATURE:
+    case GET_MAX_TEMPERATURE:
         return 8;
     case FB_SET_DEPTH:
+    case FB_WAIT_FOR_VSYNC:
         return 4;
     }
     return 0;
 }
 
+static void mailbox_free(PropertyMessageBuffer *buffer, bool scratch,
+                         size_t mark)
+{
+    if (scratch) {
+        FrameArenaRelease(&g_frameArena, mark);
+    } else {
+        free(buffer);
+    }
+}
+
 int mailbox_send_messages(PropertyMessageTag *tags)
 {
     uint32_t size = 3 * sizeof(uint32_t), pos = 0;
     for (int i = 0; tags[i].tag != NULL_TAG; ++i) {
         size += get_value_buffer_size(tags[i].tag) + 3 * sizeof(uint32_t);
     }
-    size += size % 16 ? 16 - (size % 16) : 0;
-
-    PropertyMessageBuffer *buffer = malloc(size);
+    // whole cache lines, so invalidating the buffer cannot drop a
+    // neighbour's dirty data; this also keeps the 16-byte multiple the
+    // firmware needs
+    size = (size + FRAME_ARENA_ALIGN - 1) & ~(FRAME_ARENA_ALIGN - 1);
+
+    // the buffer only lives for this call, so it comes from the frame arena
+    // unless that is full
+    const size_t mark = FrameArenaMark(&g_frameArena);
+    PropertyMessageBuffer *buffer = FrameArenaAlloc(&g_frameArena, size);
+    const bool scratch = buffer != NULL;
+    if (!scratch) {
+        buffer = aligned_alloc(FRAME_ARENA_ALIGN, size);
+        if (buffer == NULL) {
+            return 3;
+        }
+    }
     buffer->code = MESSAGE_CODE_REQUEST;
     buffer->size = size;
     for (int i = 0; tags[i].tag != NULL_TAG; ++i) {
@@ -83,16 +115,19 @@ int mailbox_send_messages(PropertyMessageTag *tags)
     }
     buffer->tags[pos] = NULL_TAG;
 
+    // the GPU does not see the ARM data cache
+    cache_clean_range(buffer, size);
     mailbox_write(MAILBOX_PROPERTY_CHANNEL, (uint32_t) (uintptr_t) buffer >> 4);
     (void) mailbox_read(MAILBOX_PROPERTY_CHANNEL);
+    cache_invalidate_range(buffer, size);
 
     if (buffer->code == MESSAGE_CODE_REQUEST) {
-        free(buffer);
+        mailbox_free(buffer, scratch, mark);
         return 1;
     }
 
     if (buffer->code == MESSAGE_CODE_RESPONSE_ERROR) {
-        free(buffer);
+        mailbox_free(buffer, scratch, mark);
         return 2;
     }
 
@@ -104,6 +139,6 @@ int mailbox_send_messages(PropertyMessageTag *tags)
         pos += length >> 2;
     }
 
-    free(buffer);
+    mailbox_free(buffer, scratch, mark);
     return 0;
 }
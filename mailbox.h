@@ -8,6 +8,11 @@ typedef struct {
     uint32_t height;
 } __attribute__((packed)) FbScreenSize;
 
+typedef struct {
+    uint32_t x;
+    uint32_t y;
+} __attribute__((packed)) FbOffset;
+
 typedef struct {
     uint32_t clockId;
     uint32_t rate;
@@ -24,24 +29,48 @@ typedef struct {
     uint32_t rate;
 } __attribute__((packed)) ClockRateRes;
 
+typedef struct {
+    uint32_t base;
+    uint32_t size;
+} __attribute__((packed)) ArmMemoryRes;
+
+typedef struct {
+    uint32_t temperatureId;
+    // thousandths of a degree Celsius
+    uint32_t value;
+} __attribute__((packed)) TemperatureRes;
+
 typedef union {
     FbScreenSize fbScreenSize;
     uint32_t fbBitsPerPixel;
+    FbOffset fbVirtualOffset;
     uint32_t fbAllocateAlignment;
+    uint32_t fbVsync;
     uint32_t clockId;
     ClockRateSetInfo clockRateSetInfo;
 
     FbAllocateRes fbAllocateRes;
     ClockRateRes clockRateRes;
+    ArmMemoryRes armMemoryRes;
+    TemperatureRes temperatureRes;
 } ValueBuffer;
 
 #define NULL_TAG 0
+#define GET_ARM_MEMORY 0x00010005
 #define FB_ALLOCATE_TAG 0x00040001
 #define FB_SET_PHYSICAL_SIZE 0x00048003
 #define FB_SET_VIRTUAL_SIZE 0x00048004
 #define FB_SET_DEPTH 0x00048005
+#define FB_SET_VIRTUAL_OFFSET 0x00048009
+#define FB_WAIT_FOR_VSYNC 0x0004800E
+#define CLOCK_GET_RATE 0x00030002
 #define CLOCK_GET_MAX_RATE 0x00030004
 #define CLOCK_SET_RATE 0x00038002
+#define GET_TEMPERATURE 0x00030006
+#define GET_MAX_TEMPERATURE 0x0003000A
+
+#define CLOCK_ID_ARM 3
+#define CLOCK_ID_CORE 4
 
 typedef struct {
     uint32_t tag;
@@ -52,6 +81,9 @@ uint32_t mailbox_read(uint8_t channel);
 
 void mailbox_write(uint8_t channel, uint32_t data);
 
+// Sends the tags up to NULL_TAG and copies the answers back into them.
+// Returns 0 on success, 1 when the firmware did not handle the request, 2
+// when it reported an error and 3 when no buffer could be allocated.
 int mailbox_send_messages(PropertyMessageTag *tags);
 
 #endif  // MAILBOX_H
@@ -1,67 +1,236 @@
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "arena.h"
+#include "capture.h"
+#include "dma.h"
 #include "fb.h"
 #include "game.h"
+#include "map.h"
 #include "mem.h"
+#include "mmu.h"
+#include "platform.h"
+#include "profile.h"
 #include "raycaster_data.h"
 #include "raycaster_fixed.h"
+#include "raycaster_float.h"
 #include "renderer.h"
+#include "resolution.h"
+#include "text.h"
 #include "timer.h"
 #include "uart.h"
+#include "world.h"
 
 char *itoa(int value, char *str, int base);
 
-void copy_buffer(uint32_t *fb, uint32_t *buffer)
+// map or world file linked in by map_blob.S
+extern const uint8_t __map_start[];
+extern const uint8_t __map_end[];
+
+// Upscales the width x height render buffer to the whole framebuffer. The
+// CPU stretches every source row once into a cached staging buffer; the DMA
+// engine then copies each staged row out to the write-combining framebuffer
+// as often as it repeats, while the CPU goes on with the next frame.
+void copy_buffer(uint32_t *fb,
+                 uint32_t *staging,
+                 DmaControlBlock *blocks,
+                 const uint32_t *buffer,
+                 uint16_t width,
+                 uint16_t height)
 {
-    for (uint16_t x = 0; x < SCREEN_WIDTH; ++x) {
-        for (uint16_t y = 0; y < SCREEN_HEIGHT; ++y) {
-            uint32_t color = buffer[y * SCREEN_WIDTH + x];
-            for (int i = 0; i < SCREEN_SCALE; ++i) {
-                for (int j = 0; j < SCREEN_SCALE; ++j) {
-                    fb[(y * SCREEN_SCALE + j) * FB_WIDTH +
-                       (x * SCREEN_SCALE + i)] = color;
-                }
-            }
+    const uint32_t stepX = ((uint32_t) width << 16) / FB_WIDTH;
+    const uint32_t stepY = ((uint32_t) height << 16) / FB_HEIGHT;
+    profile_begin(PROFILE_FILL);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint32_t *src = buffer + y * width;
+        uint32_t *row = staging + y * FB_WIDTH;
+        uint32_t srcX = 0;
+        for (uint32_t x = 0; x < FB_WIDTH; ++x) {
+            row[x] = src[srcX >> 16];
+            srcX += stepX;
         }
     }
+    cache_clean_range(staging, height * FB_WIDTH * sizeof(uint32_t));
+
+    for (uint32_t y = 0; y < FB_HEIGHT; ++y) {
+        const uint32_t srcY = (y * stepY) >> 16;
+        dma_copy_block(&blocks[y], fb + y * FB_WIDTH,
+                       staging + srcY * FB_WIDTH,
+                       FB_WIDTH * sizeof(uint32_t));
+        dma_chain(&blocks[y], y + 1 < FB_HEIGHT ? &blocks[y + 1] : NULL);
+    }
+    dma_start(DMA_BLIT_CHANNEL, blocks, FB_HEIGHT);
+    profile_end(PROFILE_FILL);
+}
+
+// A serial terminal sends no key releases, only repeats while a key is held:
+// one character, then the autorepeat delay of 250 to 600 ms, then one every
+// 30 to 100 ms. A key counts as held through that delay after its first
+// character, and for a shorter while after a repeat so letting go stops the
+// player quickly.
+#define KEY_HOLD_FIRST 600000
+#define KEY_HOLD_REPEAT 150000
+
+typedef struct {
+    uint64_t seen;
+    bool repeating;
+} KeyState;
+
+static void key_pressed(KeyState *state, uint64_t now)
+{
+    state->repeating = state->seen != 0 && now - state->seen < KEY_HOLD_FIRST;
+    state->seen = now;
+}
+
+static bool key_held(const KeyState *keys, char key, uint64_t now)
+{
+    const KeyState *state = &keys[(int) key];
+    const uint64_t hold = state->repeating ? KEY_HOLD_REPEAT : KEY_HOLD_FIRST;
+    return state->seen != 0 && now - state->seen < hold;
 }
 
 void main()
 {
-    uint32_t *buffer = malloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
-    RayCaster *rayCaster = RayCasterFixedConstruct();
-    Game game = GameConstruct();
-    Renderer renderer = RendererConstruct(rayCaster);
+    static Platform platform;
+    platform_init(&platform);
+    uint32_t *buffer =
+        aligned_alloc(64, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    static Map flatMap;
+    static World world;
+    Map *map = &flatMap;
+    const bool streaming =
+        WorldLoad(&world, __map_start, __map_end - __map_start);
+    if (streaming) {
+        map = &world.map;
+    } else if (!MapLoad(&flatMap, __map_start, __map_end - __map_start)) {
+        flatMap = MapConstruct();
+    }
+    RayCaster *fixedCaster = RayCasterFixedConstruct(map);
+    // VFP float caster, swapped in with 'v' to compare against fixed-point
+    RayCaster *floatCaster = RayCasterFloatConstruct(map);
+    Game game = GameConstruct(map);
+    Renderer renderer = RendererConstruct(fixedCaster);
+    RendererSetInterleaved(&renderer, true);
+    TextRenderer text = TextRendererConstruct(g_font);
+    ResolutionController resolution = ResolutionControllerConstruct(16666);
 
-    uint32_t *fb = fb_create(FB_WIDTH, FB_HEIGHT, 32);
+    Framebuffer fb;
+    if (!fb_create(&fb, FB_WIDTH, FB_HEIGHT, 32)) {
+        uart_puts("Could not allocate the framebuffer\r\n");
+        return;
+    }
+    mmu_map_region((uintptr_t) fb.base, fb.size, MMU_WRITE_COMBINE);
+    static DmaControlBlock blitBlocks[FB_HEIGHT];
+    uint32_t *staging =
+        aligned_alloc(64, FB_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    bool blitPending = false;
+    static KeyState keys[128];
+    bool captureRequested = false;
+    dma_init(DMA_BLIT_CHANNEL);
+    profile_init();
     uint64_t tickCounter = timer_clock(), elapsed = 0;
     int frameCounter = 0, frameRate = 0;
+    size_t arenaReported = 0;
     for (;;) {
+        FrameArenaReset(&g_frameArena);
+        if (g_frameArena.highWater > arenaReported) {
+            // report new peaks once, for sizing FRAME_ARENA_SIZE
+            char arenabuf[16];
+            arenaReported = g_frameArena.highWater;
+            uart_puts("frame arena peak: ");
+            uart_puts(itoa(arenaReported, arenabuf, 10));
+            uart_puts("\r\n");
+        }
+        profile_begin(PROFILE_WORLD);
+        if (streaming) {
+            WorldUpdate(&world, &game);
+        }
+        profile_end(PROFILE_WORLD);
+        const uint64_t renderCounter = timer_clock();
+        const bool interleaved = renderer.interleaved;
+        RayCaster *rayCaster = renderer.rc;
+        if (captureRequested) {
+            // a captured frame has to be reproducible from the view alone,
+            // by the same fixed-point caster tools/fbcapture uses
+            RendererSetInterleaved(&renderer, false);
+            RendererSetRayCaster(&renderer, fixedCaster);
+        }
+        profile_begin(PROFILE_TRACE);
         RendererTraceFrame(&renderer, &game, buffer);
+        profile_end(PROFILE_TRACE);
+        if (captureRequested) {
+            // before the HUD, for tools/fbcapture
+            capture_send(buffer, renderer.width, renderer.height,
+                         game.playerX, game.playerY, game.playerA,
+                         (renderer.flats ? CAPTURE_FLATS : 0) |
+                             (renderer.lighting ? CAPTURE_LIGHTING : 0));
+            RendererSetRayCaster(&renderer, rayCaster);
+            RendererSetInterleaved(&renderer, interleaved);
+            captureRequested = false;
+        }
+        profile_begin(PROFILE_HUD);
         char fpsbuf[64] = "FPS: ";
         itoa(frameRate, fpsbuf + 5, 10);
-        fb_puts(buffer, SCREEN_WIDTH, SCREEN_HEIGHT, g_font, fpsbuf, 0, 0);
-        copy_buffer(fb, buffer);
+        TextRendererPuts(&text, buffer, renderer.width, renderer.height, fpsbuf,
+                         0, 0, 0xFFFFFFFF);
+        profile_end(PROFILE_HUD);
+        // the resolution follows the cost of drawing alone: fb_flip() waits
+        // for vsync, which would pull every frame up to the refresh period
+        uint64_t renderTime = timer_clock() - renderCounter;
+        // last frame's blit has to land before its page is shown and its
+        // staging rows are overwritten; then upscale into the hidden page
+        profile_begin(PROFILE_COPY);
+        dma_wait(DMA_BLIT_CHANNEL);
+        if (blitPending) {
+            fb_flip(&fb);
+        }
+        profile_end(PROFILE_COPY);
+        const uint64_t fillCounter = timer_clock();
+        copy_buffer(fb_back_buffer(&fb), staging, blitBlocks, buffer,
+                    renderer.width, renderer.height);
+        renderTime += timer_clock() - fillCounter;
+        blitPending = true;
+
+        if (ResolutionControllerUpdate(&resolution, renderTime)) {
+            RendererSetResolution(&renderer, resolution.width,
+                                  resolution.height);
+        }
 
-        int m = 0, r = 0;
-        if (!uart_empty()) {
-            char c = uart_getc();
+        // drain everything received since the last frame
+        profile_begin(PROFILE_MOVE);
+        const uint64_t now = timer_clock();
+        while (!uart_empty()) {
+            const char c = uart_getc();
+            key_pressed(&keys[c & 0x7F], now);
             switch (c) {
-            case 'w':
-                m = 1;
+            case 'i':
+                RendererSetInterleaved(&renderer, !renderer.interleaved);
+                break;
+            case 'f':
+                RendererSetFlats(&renderer, !renderer.flats);
+                break;
+            case 'l':
+                RendererSetLighting(&renderer, !renderer.lighting);
                 break;
-            case 'a':
-                r = -1;
+            case 'c':
+                captureRequested = true;
                 break;
-            case 's':
-                m = -1;
+            case 'p':
+                // binary records for tools/profdecode
+                profile_set_streaming(!profile_streaming());
                 break;
-            case 'd':
-                r = 1;
+            case 'v':
+                RendererSetRayCaster(&renderer, renderer.rc == fixedCaster
+                                                    ? floatCaster
+                                                    : fixedCaster);
+                uart_puts(renderer.rc == fixedCaster ? "caster: fixed\r\n"
+                                                     : "caster: float\r\n");
                 break;
             }
         }
+        const int m = key_held(keys, 'w', now) - key_held(keys, 's', now);
+        const int r = key_held(keys, 'd', now) - key_held(keys, 'a', now);
 
         uint64_t nextCounter = timer_clock();
         uint64_t ticks = nextCounter - tickCounter;
@@ -72,10 +241,15 @@ void main()
             frameRate = frameCounter;
             frameCounter = 0;
             elapsed -= 1000000;
+            platform_update(&platform);
         }
         GameMove(&game, m, r, ticks >> 12);
+        profile_end(PROFILE_MOVE);
+        profile_frame();
     }
 
-    rayCaster->Destruct(rayCaster);
+    floatCaster->Destruct(floatCaster);
+    fixedCaster->Destruct(fixedCaster);
+    free(staging);
     free(buffer);
 }
@@ -2,48 +2,74 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "arena.h"
+#include "atlas.h"
 #include "game.h"
+#include "map.h"
 #include "raycaster.h"
+#include "raycaster_data.h"
 #include "raycaster_fixed.h"
 #include "raycaster_float.h"
 #include "renderer.h"
+#include "resolution.h"
+#include "shade.h"
+#include "text.h"
+#include "world.h"
 
 // 函數：draw_buffer
 // 參數：sdlRenderer - SDL 渲染器
 //       sdlTexture - SDL 紋理
 //       fb - 彩色緩衝區
+//       width - 緩衝區寬度（內部解析度）
+//       height - 緩衝區高度（內部解析度）
 //       dx - x方向偏移
-// 說明：將彩色緩衝區的內容渲染到 SDL 窗口上
+// 說明：將彩色緩衝區的內容放大渲染到 SDL 窗口上
 static void draw_buffer(SDL_Renderer *sdlRenderer,
                         SDL_Texture *sdlTexture,
                         uint32_t *fb,
+                        int width,
+                        int height,
                         int dx)
 {
     int pitch = 0;
     void *pixelsPtr;
-    if (SDL_LockTexture(sdlTexture, NULL, &pixelsPtr, &pitch)) {
+    SDL_Rect s;
+    s.x = 0;
+    s.y = 0;
+    s.w = width;
+    s.h = height;
+    if (SDL_LockTexture(sdlTexture, &s, &pixelsPtr, &pitch)) {
         fprintf(stderr, "Unable to lock texture");
         exit(1);
     }
-    memcpy(pixelsPtr, fb, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    for (int y = 0; y < height; y++) {
+        memcpy((uint8_t *) pixelsPtr + y * pitch, fb + y * width,
+               width * sizeof(uint32_t));
+    }
     SDL_UnlockTexture(sdlTexture);
     SDL_Rect r;
     r.x = dx * SCREEN_SCALE;
     r.y = 0;
     r.w = SCREEN_WIDTH * SCREEN_SCALE;
     r.h = SCREEN_HEIGHT * SCREEN_SCALE;
-    SDL_RenderCopy(sdlRenderer, sdlTexture, NULL, &r);
+    SDL_RenderCopy(sdlRenderer, sdlTexture, &s, &r);
 }
 
 // 函數：process_event
 // 參數：event - SDL 事件
 //       moveDirection - 移動方向
 //       rotateDirection - 旋轉方向
+//       interleaved - 交錯列渲染模式（按 I 切換）
+//       flats - 地板與天花板貼圖（按 F 切換）
+//       lighting - 距離霧化與光照（按 L 切換）
 // 返回：如果事件為退出事件，返回 true；否則返回 false
 // 說明：處理 SDL 事件，並更新移動和旋轉方向
 static bool process_event(const SDL_Event *event,
                           int *moveDirection,
-                          int *rotateDirection)
+                          int *rotateDirection,
+                          bool *interleaved,
+                          bool *flats,
+                          bool *lighting)
 {
     if (event->type == SDL_QUIT) {
         return true;
@@ -67,6 +93,21 @@ static bool process_event(const SDL_Event *event,
         case SDLK_RIGHT:
             *rotateDirection = p ? 1 : 0;
             break;
+        case SDLK_i:
+            if (p) {
+                *interleaved = !*interleaved;
+            }
+            break;
+        case SDLK_f:
+            if (p) {
+                *flats = !*flats;
+            }
+            break;
+        case SDLK_l:
+            if (p) {
+                *lighting = !*lighting;
+            }
+            break;
         default:
             break;
         }
@@ -76,7 +117,7 @@ static bool process_event(const SDL_Event *event,
 
 // 主函數：main
 // 參數：argc - 命令行參數數量
-//       args - 命令行參數
+//       args - 命令行參數：args[1] 為紋理圖集檔案，args[2] 為地圖檔案
 // 返回：程式退出碼
 // 說明：程式的主入口點
 int main(int argc, char *args[])
@@ -96,19 +137,43 @@ int main(int argc, char *args[])
             printf("Window could not be created! SDL_Error: %s\n",
                    SDL_GetError());
         } else {
+            // 映射地圖檔案（一般地圖或分塊串流的世界）；找不到時使用內建地圖
+            static Map flatMap;
+            static World world;
+            flatMap = MapConstruct();
+            Map *map = &flatMap;
+            bool streaming = false;
+            const char *mapPath = argc > 2 ? args[2] : "default.map";
+            if (WorldOpen(&world, mapPath)) {
+                map = &world.map;
+                streaming = true;
+            } else if (!MapOpen(&flatMap, mapPath) && argc > 2) {
+                printf("Could not load map %s\n", mapPath);
+            }
+
             // 初始化遊戲和光線追踪器
-            Game game;
-            RayCaster *floatCaster = RayCasterFloatConstruct();
+            Game game = GameConstruct(map);
+            RayCaster *floatCaster = RayCasterFloatConstruct(map);
             Renderer floatRenderer = RendererConstruct(floatCaster);
             uint32_t floatBuffer[SCREEN_WIDTH * SCREEN_HEIGHT];
-            RayCaster *fixedCaster = RayCasterFixedConstruct();
+            RayCaster *fixedCaster = RayCasterFixedConstruct(map);
             Renderer fixedRenderer = RendererConstruct(fixedCaster);
             uint32_t fixedBuffer[SCREEN_WIDTH * SCREEN_HEIGHT];
+            TextRenderer text = TextRendererConstruct(g_font);
+            // 以 60 FPS 為目標的動態解析度控制（單位：微秒）
+            ResolutionController resolution =
+                ResolutionControllerConstruct(16666);
             int moveDirection = 0;
             int rotateDirection = 0;
             bool isExiting = false;
+            bool interleaved = false;
+            bool flats = true;
+            bool lighting = true;
             const Uint64 tickFrequency = SDL_GetPerformanceFrequency();
             Uint64 tickCounter = SDL_GetPerformanceCounter();
+            Uint64 elapsed = 0;
+            int frameCounter = 0, frameRate = 0;
+            char fpsbuf[64];
             SDL_Event event;
 
             // 創建 SDL 渲染器和紋理
@@ -122,16 +187,59 @@ int main(int argc, char *args[])
                 sdlRenderer, SDL_PIXELFORMAT_ABGR8888,
                 SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
 
+            // 映射紋理圖集；找不到時使用內建紋理
+            TextureAtlas atlas = {0};
+            const char *atlasPath = argc > 1 ? args[1] : "textures.atlas";
+            if (TextureAtlasOpen(&atlas, atlasPath, SHADE_LEVELS)) {
+                RendererSetTextures(&floatRenderer, atlas.texels,
+                                    atlas.textures);
+                RendererSetTextures(&fixedRenderer, atlas.texels,
+                                    atlas.textures);
+            } else if (argc > 1) {
+                printf("Could not load texture atlas %s\n", atlasPath);
+            }
+
+            RendererSetFlats(&floatRenderer, flats);
+            RendererSetFlats(&fixedRenderer, flats);
+            RendererSetLighting(&floatRenderer, lighting);
+            RendererSetLighting(&fixedRenderer, lighting);
+
             // 主循環
             while (!isExiting) {
+                FrameArenaReset(&g_frameArena);
                 // 更新遊戲和光線追踪器，獲取渲染的彩色緩衝區
+                if (streaming) {
+                    WorldUpdate(&world, &game);
+                }
+                const Uint64 renderCounter = SDL_GetPerformanceCounter();
                 RendererTraceFrame(&floatRenderer, &game, floatBuffer);
                 RendererTraceFrame(&fixedRenderer, &game, fixedBuffer);
+                const int width = fixedRenderer.width;
+                const int height = fixedRenderer.height;
+
+                // 疊加 FPS 資訊
+                snprintf(fpsbuf, sizeof(fpsbuf), "FPS: %d", frameRate);
+                TextRendererPuts(&text, fixedBuffer, width, height, fpsbuf, 0,
+                                 0, 0xFFFFFFFF);
+                TextRendererPuts(&text, floatBuffer, width, height, fpsbuf, 0,
+                                 0, 0xFFFFFFFF);
+
+                // 依渲染耗時調整下一幀的內部解析度
+                const Uint64 renderTicks =
+                    SDL_GetPerformanceCounter() - renderCounter;
+                if (ResolutionControllerUpdate(
+                        &resolution, renderTicks * 1000000 / tickFrequency)) {
+                    RendererSetResolution(&floatRenderer, resolution.width,
+                                          resolution.height);
+                    RendererSetResolution(&fixedRenderer, resolution.width,
+                                          resolution.height);
+                }
 
                 // 渲染彩色緩衝區到窗口上
-                draw_buffer(sdlRenderer, fixedTexture, fixedBuffer, 0);
-                draw_buffer(sdlRenderer, floatTexture, floatBuffer,
-                            SCREEN_WIDTH + 1);
+                draw_buffer(sdlRenderer, fixedTexture, fixedBuffer, width,
+                            height, 0);
+                draw_buffer(sdlRenderer, floatTexture, floatBuffer, width,
+                            height, SCREEN_WIDTH + 1);
 
                 // 更新 SDL 窗口
                 SDL_RenderPresent(sdlRenderer);
@@ -139,15 +247,37 @@ int main(int argc, char *args[])
                 // 處理事件並更新遊戲狀態
                 if (SDL_PollEvent(&event)) {
                     isExiting =
-                        process_event(&event, &moveDirection, &rotateDirection);
+                        process_event(&event, &moveDirection, &rotateDirection,
+                                      &interleaved, &flats, &lighting);
+                    if (interleaved != fixedRenderer.interleaved) {
+                        RendererSetInterleaved(&floatRenderer, interleaved);
+                        RendererSetInterleaved(&fixedRenderer, interleaved);
+                    }
+                    RendererSetFlats(&floatRenderer, flats);
+                    RendererSetFlats(&fixedRenderer, flats);
+                    RendererSetLighting(&floatRenderer, lighting);
+                    RendererSetLighting(&fixedRenderer, lighting);
                 }
                 const Uint64 nextCounter = SDL_GetPerformanceCounter();
                 const Uint64 ticks = nextCounter - tickCounter;
                 tickCounter = nextCounter;
+                elapsed += ticks;
+                ++frameCounter;
+                if (elapsed > tickFrequency) {
+                    frameRate = frameCounter;
+                    frameCounter = 0;
+                    elapsed -= tickFrequency;
+                }
                 GameMove(&game, moveDirection, rotateDirection,
                          ticks / (SDL_GetPerformanceFrequency() >> 8));
             }
+            // 每幀暫存區的用量，用來調整 FRAME_ARENA_SIZE
+            printf("Frame arena peak: %zu of %zu bytes, %u failed\n",
+                   g_frameArena.highWater, g_frameArena.size,
+                   (unsigned) g_frameArena.failures);
             // 釋放資源
+            TextureAtlasClose(&atlas);
+            MapClose(map);
             SDL_DestroyTexture(floatTexture);
             SDL_DestroyTexture(fixedTexture);
             SDL_DestroyRenderer(sdlRenderer);
@@ -0,0 +1,91 @@
+#include "map.h"
+
+#include "raycaster_data.h"
+
+Map MapConstruct(void)
+{
+    Map map;
+    map.width = MAP_X;
+    map.height = MAP_Y;
+    map.chunkShift = 8;
+    map.chunksX = 1;
+    map.wallStride = MAP_X >> 3;
+    map.typeStride = MAP_X >> 1;
+    map.lightStride = MAP_X;
+    map.walls[0] = g_map;
+    map.types[0] = g_tileMap;
+    map.light[0] = g_lightMap;
+    map.distance = NULL;
+    map.spawns = &g_mapSpawn;
+    map.spawnCount = 1;
+    map.mapping = NULL;
+    map.length = 0;
+    return map;
+}
+
+// whether [offset, offset + length) lies inside an image of the given size
+static bool MapSectionFits(uint32_t offset, size_t length, size_t size)
+{
+    return offset >= sizeof(MapHeader) && offset <= size &&
+           length <= size - offset;
+}
+
+bool MapSpawnsInside(const MapSpawn *spawns,
+                     uint16_t count,
+                     uint16_t width,
+                     uint16_t height)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        if (spawns[i].x >= width << 8 || spawns[i].y >= height << 8) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MapLoad(Map *map, const void *data, size_t size)
+{
+    const MapHeader *header = (const MapHeader *) data;
+    if (size < sizeof(MapHeader) || header->magic != MAP_MAGIC ||
+        header->version != MAP_VERSION) {
+        return false;
+    }
+    const uint16_t width = header->width;
+    const uint16_t height = header->height;
+    const uint16_t wallStride = (width + 7) >> 3;
+    const uint16_t typeStride = (width + 1) >> 1;
+    if (width < 2 || height < 2 || width > MAP_MAX_SIZE ||
+        height > MAP_MAX_SIZE || header->spawns == 0 ||
+        header->spawn % sizeof(uint16_t) != 0 ||
+        !MapSectionFits(header->walls, wallStride * height, size) ||
+        !MapSectionFits(header->types, typeStride * height, size) ||
+        !MapSectionFits(header->light, width * height, size) ||
+        !MapSectionFits(header->spawn, header->spawns * sizeof(MapSpawn),
+                        size) ||
+        (header->distance != 0 &&
+         !MapSectionFits(header->distance, width * height, size))) {
+        return false;
+    }
+    const uint8_t *base = (const uint8_t *) data;
+    if (!MapSpawnsInside((const MapSpawn *) (base + header->spawn),
+                         header->spawns, width, height)) {
+        return false;
+    }
+
+    map->width = width;
+    map->height = height;
+    map->chunkShift = 8;
+    map->chunksX = 1;
+    map->wallStride = wallStride;
+    map->typeStride = typeStride;
+    map->lightStride = width;
+    map->walls[0] = base + header->walls;
+    map->types[0] = base + header->types;
+    map->light[0] = base + header->light;
+    map->distance = header->distance != 0 ? base + header->distance : NULL;
+    map->spawns = (const MapSpawn *) (base + header->spawn);
+    map->spawnCount = header->spawns;
+    map->mapping = NULL;
+    map->length = 0;
+    return true;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "raycaster.h"
+
+#define MAP_MAGIC 0x504D4352 // "RCMP"
+#define MAP_VERSION 1
+// tile coordinates are 8 bits in the fixed-point caster, and one that steps
+// off the top or left edge wraps around to 255, so 128 tells the two apart
+#define MAP_MAX_SIZE 128
+// smallest chunks a map can be split into, 32x32 tiles
+#define MAP_CHUNK_SHIFT 5
+#define MAP_MAX_CHUNKS \
+    ((MAP_MAX_SIZE >> MAP_CHUNK_SHIFT) * (MAP_MAX_SIZE >> MAP_CHUNK_SHIFT))
+
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    int16_t a;
+    uint16_t reserved;
+} MapSpawn;
+
+// On-disk header of a map file, host byte order. All offsets are from
+// the start of the file; a zero offset marks an optional section absent.
+//   walls    - occupancy bitmap, (width + 7) / 8 bytes per row, MSB first
+//   types    - 4-bit tile types, (width + 1) / 2 bytes per row, even tile
+//              in the low nibble
+//   light    - one light map level per tile
+//   spawns   - MapSpawn[spawns], in 8.8 tiles
+//   distance - optional, Chebyshev distance in tiles to the nearest wall
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t spawns;
+    uint16_t width;
+    uint16_t height;
+    uint32_t walls;
+    uint32_t types;
+    uint32_t light;
+    uint32_t spawn;
+    uint32_t distance;
+} MapHeader;
+
+// Tiles are grouped into square chunks of 1 << chunkShift tiles a side, each
+// with its own walls, types and light pointers, so that a streamed world
+// can page chunks in and out. A flat map is a single chunk.
+typedef struct Map {
+    uint16_t width;
+    uint16_t height;
+    uint8_t chunkShift;
+    uint8_t chunksX;
+    uint16_t wallStride;
+    uint16_t typeStride;
+    uint16_t lightStride;
+    const uint8_t *walls[MAP_MAX_CHUNKS];
+    const uint8_t *types[MAP_MAX_CHUNKS];
+    const uint8_t *light[MAP_MAX_CHUNKS];
+    const uint8_t *distance;
+    const MapSpawn *spawns;
+    uint16_t spawnCount;
+    // set when the map owns a file mapping
+    void *mapping;
+    size_t length;
+} Map;
+
+// The map compiled into raycaster_data.c.
+Map MapConstruct(void);
+
+// Points a map at a map file image in memory, eg. a mapped file or one
+// linked into the binary. Nothing is copied, the image must outlive it.
+bool MapLoad(Map *map, const void *data, size_t size);
+
+// Whether every spawn lies on the map, in 8.8 tiles.
+bool MapSpawnsInside(const MapSpawn *spawns,
+                     uint16_t count,
+                     uint16_t width,
+                     uint16_t height);
+
+// Maps a map file read-only, only available on hosted builds.
+bool MapOpen(Map *map, const char *path);
+
+void MapClose(Map *map);
+
+static inline uint8_t MapChunk(const Map *map, uint8_t tileX, uint8_t tileY)
+{
+    return (tileY >> map->chunkShift) * map->chunksX +
+           (tileX >> map->chunkShift);
+}
+
+static inline bool MapIsWall(const Map *map, uint8_t tileX, uint8_t tileY)
+{
+    if (tileX >= map->width - 1 || tileY >= map->height - 1) {
+        return true;
+    }
+    const uint8_t mask = (1 << map->chunkShift) - 1;
+    return LOOKUP8(map->walls[MapChunk(map, tileX, tileY)],
+                   ((tileX & mask) >> 3) + (tileY & mask) * map->wallStride) &
+           (0x80 >> (tileX & 0x7));
+}
+
+// Texture of a wall tile, 0 outside the map. Only meaningful where
+// MapIsWall() holds, which stays the bitmap the traversal reads.
+static inline uint8_t MapTileType(const Map *map, uint8_t tileX, uint8_t tileY)
+{
+    if (tileX >= map->width || tileY >= map->height) {
+        return 0;
+    }
+    const uint8_t mask = (1 << map->chunkShift) - 1;
+    return (LOOKUP8(map->types[MapChunk(map, tileX, tileY)],
+                    ((tileX & mask) >> 1) + (tileY & mask) * map->typeStride) >>
+            ((tileX & 1) << 2)) &
+           0xF;
+}
+
+static inline uint8_t MapLight(const Map *map, uint8_t tileX, uint8_t tileY)
+{
+    if (tileX >= map->width || tileY >= map->height) {
+        return 0;
+    }
+    const uint8_t mask = (1 << map->chunkShift) - 1;
+    return LOOKUP8(map->light[MapChunk(map, tileX, tileY)],
+                   (tileX & mask) + (tileY & mask) * map->lightStride);
+}
@@ -0,0 +1,70 @@
+#include "map.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "world.h"
+
+static void *MapFileMap(const char *path, size_t *length)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *mapping =
+        mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    *length = (size_t) st.st_size;
+    return mapping;
+}
+
+bool MapOpen(Map *map, const char *path)
+{
+    size_t length;
+    void *mapping = MapFileMap(path, &length);
+    if (mapping == NULL) {
+        return false;
+    }
+    if (!MapLoad(map, mapping, length)) {
+        munmap(mapping, length);
+        return false;
+    }
+    map->mapping = mapping;
+    map->length = length;
+    return true;
+}
+
+bool WorldOpen(World *world, const char *path)
+{
+    size_t length;
+    void *mapping = MapFileMap(path, &length);
+    if (mapping == NULL) {
+        return false;
+    }
+    if (!WorldLoad(world, mapping, length)) {
+        munmap(mapping, length);
+        return false;
+    }
+    world->map.mapping = mapping;
+    world->map.length = length;
+    return true;
+}
+
+void MapClose(Map *map)
+{
+    if (map->mapping != NULL) {
+        munmap(map->mapping, map->length);
+        map->mapping = NULL;
+        map->length = 0;
+    }
+}
@@ -1,78 +1,382 @@
-#include <stdbool.h>
-#include <stddef.h>
+#include "mem.h"
+
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
-#define HEAP_SIZE 1024 * 1024
+#ifndef MEM_HOST
+#include "mailbox.h"
+#endif
 
-typedef struct HeapSegmentHeader {
-    uint32_t allocated;
-    uint32_t size;
-    struct HeapSegmentHeader *prev;
-    struct HeapSegmentHeader *next;
-} __attribute__((packed)) HeapSegmentHeader;
+// Two-level segregated fit: free blocks are binned by their top bit (first
+// level) and the HEAP_SL_LOG2 bits below it (second level). A bitmap per
+// level finds the smallest non-empty bin that fits, so malloc and free take
+// constant time however fragmented the heap gets.
 
-extern uint8_t __end[HEAP_SIZE];
+#define HEAP_ALIGN 16
+#define HEAP_SL_LOG2 4
+#define HEAP_SL_COUNT (1 << HEAP_SL_LOG2)
+// sizes below HEAP_SMALL all live in the first level, 16 bytes per bin
+#define HEAP_FL_SHIFT (HEAP_SL_LOG2 + 4)
+#define HEAP_SMALL (1 << HEAP_FL_SHIFT)
+#define HEAP_FL_COUNT (32 - HEAP_FL_SHIFT + 1)
 
-static HeapSegmentHeader *heapSegmentsHead;
+#define HEAP_MAX_REQUEST (1u << 30)
+#define HEAP_MAX_POOL (1u << 31)
 
-void mem_init(void)
+// enough to ask the firmware how much memory there is
+#define HEAP_BOOT_SIZE (64 * 1024)
+// used when the firmware does not answer
+#define HEAP_FALLBACK_SIZE (1024 * 1024)
+
+#define HEAP_FREE 1u
+
+typedef struct HeapBlock {
+    struct HeapBlock *prevPhys;
+    // whole block including this header, HEAP_FREE in the low bit
+    size_t size;
+    // free blocks only, overlaps the payload
+    struct HeapBlock *nextFree;
+    struct HeapBlock *prevFree;
+} HeapBlock;
+
+#define HEAP_HEADER offsetof(HeapBlock, nextFree)
+#define HEAP_MIN_BLOCK \
+    ((sizeof(HeapBlock) + HEAP_ALIGN - 1) & ~(size_t) (HEAP_ALIGN - 1))
+
+#ifdef MEM_HOST
+#ifndef MEM_HOST_HEAP_SIZE
+#define MEM_HOST_HEAP_SIZE (64 * 1024 * 1024)
+#endif
+static uint8_t memHostHeap[MEM_HOST_HEAP_SIZE] __attribute__((aligned(64)));
+#else
+extern uint8_t __end[];
+#endif
+
+static uint32_t heapFlBitmap;
+static uint32_t heapSlBitmap[HEAP_FL_COUNT];
+static HeapBlock *heapFree[HEAP_FL_COUNT][HEAP_SL_COUNT];
+
+static inline size_t heap_size(const HeapBlock *block)
+{
+    return block->size & ~(size_t) HEAP_FREE;
+}
+
+static inline HeapBlock *heap_next(const HeapBlock *block)
+{
+    return (HeapBlock *) ((uint8_t *) block + heap_size(block));
+}
+
+static inline void *heap_payload(HeapBlock *block)
+{
+    return (uint8_t *) block + HEAP_HEADER;
+}
+
+static inline HeapBlock *heap_block(void *ptr)
+{
+    return (HeapBlock *) ((uint8_t *) ptr - HEAP_HEADER);
+}
+
+// Block size for a request: payload plus header, rounded so that every
+// payload stays HEAP_ALIGN aligned.
+static inline size_t heap_adjust(size_t size)
+{
+    size = (size + HEAP_HEADER + HEAP_ALIGN - 1) & ~(size_t) (HEAP_ALIGN - 1);
+    return size < HEAP_MIN_BLOCK ? HEAP_MIN_BLOCK : size;
+}
+
+static void heap_mapping(size_t size, int *fl, int *sl)
+{
+    if (size < HEAP_SMALL) {
+        *fl = 0;
+        *sl = size / (HEAP_SMALL / HEAP_SL_COUNT);
+        return;
+    }
+    const int bit = 31 - __builtin_clz((uint32_t) size);
+    *fl = bit - HEAP_FL_SHIFT + 1;
+    *sl = (size >> (bit - HEAP_SL_LOG2)) ^ HEAP_SL_COUNT;
+}
+
+static void heap_insert(HeapBlock *block)
+{
+    int fl, sl;
+    heap_mapping(heap_size(block), &fl, &sl);
+    HeapBlock *head = heapFree[fl][sl];
+    block->nextFree = head;
+    block->prevFree = NULL;
+    if (head != NULL) {
+        head->prevFree = block;
+    }
+    heapFree[fl][sl] = block;
+    heapFlBitmap |= 1u << fl;
+    heapSlBitmap[fl] |= 1u << sl;
+}
+
+static void heap_remove(HeapBlock *block)
+{
+    int fl, sl;
+    heap_mapping(heap_size(block), &fl, &sl);
+    if (block->nextFree != NULL) {
+        block->nextFree->prevFree = block->prevFree;
+    }
+    if (block->prevFree != NULL) {
+        block->prevFree->nextFree = block->nextFree;
+        return;
+    }
+    heapFree[fl][sl] = block->nextFree;
+    if (block->nextFree == NULL) {
+        heapSlBitmap[fl] &= ~(1u << sl);
+        if (heapSlBitmap[fl] == 0) {
+            heapFlBitmap &= ~(1u << fl);
+        }
+    }
+}
+
+// Head of the first bin whose blocks are all at least size bytes, or NULL.
+static HeapBlock *heap_find(size_t size)
 {
-    heapSegmentsHead = (HeapSegmentHeader *) &__end;
-    heapSegmentsHead->allocated = false;
-    heapSegmentsHead->size = HEAP_SIZE;
-    heapSegmentsHead->prev = NULL;
-    heapSegmentsHead->next = NULL;
+    if (size >= HEAP_SMALL) {
+        // round up to the next bin boundary so that any block in it fits
+        const int bit = 31 - __builtin_clz((uint32_t) size);
+        size += (1u << (bit - HEAP_SL_LOG2)) - 1;
+    }
+    int fl, sl;
+    heap_mapping(size, &fl, &sl);
+    uint32_t slMap = heapSlBitmap[fl] & (~0u << sl);
+    if (slMap == 0) {
+        const uint32_t flMap = heapFlBitmap & (~0u << (fl + 1));
+        if (flMap == 0) {
+            return NULL;
+        }
+        fl = __builtin_ctz(flMap);
+        slMap = heapSlBitmap[fl];
+    }
+    return heapFree[fl][__builtin_ctz(slMap)];
 }
 
-void *malloc(size_t size)
+// Cuts block down to size bytes and frees the tail if it is big enough to
+// be a block of its own.
+static void heap_trim(HeapBlock *block, size_t size)
 {
-    size += sizeof(HeapSegmentHeader);
-    size += size % 16 ? 16 - (size % 16) : 0;
+    if (heap_size(block) < size + HEAP_MIN_BLOCK) {
+        return;
+    }
+    HeapBlock *rest = (HeapBlock *) ((uint8_t *) block + size);
+    rest->prevPhys = block;
+    rest->size = (heap_size(block) - size) | HEAP_FREE;
+    block->size = size | (block->size & HEAP_FREE);
 
-    HeapSegmentHeader *best = NULL;
-    size_t bestDiff = SIZE_MAX;
-    for (HeapSegmentHeader *curr = heapSegmentsHead; curr != NULL;
-         curr = curr->next) {
-        if (!curr->allocated && curr->size >= size) {
-            size_t diff = curr->size - size;
-            if (diff < bestDiff) {
-                best = curr;
-                bestDiff = diff;
+    HeapBlock *next = heap_next(rest);
+    if (next->size & HEAP_FREE) {
+        heap_remove(next);
+        rest->size += heap_size(next);
+        next = heap_next(rest);
+    }
+    next->prevPhys = rest;
+    heap_insert(rest);
+}
+
+void mem_add_pool(void *start, size_t size)
+{
+    if (size > HEAP_MAX_POOL) {
+        size = HEAP_MAX_POOL;
+    }
+    // blocks start HEAP_HEADER bytes before an aligned address, and a
+    // zero-sized used block at the end stops coalescing
+    const uintptr_t first =
+        (((uintptr_t) start + HEAP_HEADER + HEAP_ALIGN - 1) &
+         ~(uintptr_t) (HEAP_ALIGN - 1)) -
+        HEAP_HEADER;
+    const uintptr_t last =
+        (((uintptr_t) start + size) & ~(uintptr_t) (HEAP_ALIGN - 1)) -
+        HEAP_HEADER;
+    if (last < first + HEAP_MIN_BLOCK) {
+        return;
+    }
+
+    HeapBlock *block = (HeapBlock *) first;
+    HeapBlock *sentinel = (HeapBlock *) last;
+    block->prevPhys = NULL;
+    block->size = (last - first) | HEAP_FREE;
+    sentinel->prevPhys = block;
+    sentinel->size = 0;
+    heap_insert(block);
+}
+
+void mem_init(void)
+{
+    heapFlBitmap = 0;
+    memset(heapSlBitmap, 0, sizeof(heapSlBitmap));
+    memset(heapFree, 0, sizeof(heapFree));
+
+#ifdef MEM_HOST
+    mem_add_pool(memHostHeap, sizeof(memHostHeap));
+#else
+    mem_add_pool(__end, HEAP_BOOT_SIZE);
+
+    PropertyMessageTag tags[2];
+    tags[0].tag = GET_ARM_MEMORY;
+    tags[0].value.armMemoryRes.base = 0;
+    tags[0].value.armMemoryRes.size = 0;
+    tags[1].tag = NULL_TAG;
+    uintptr_t end = (uintptr_t) __end + HEAP_FALLBACK_SIZE;
+    if (mailbox_send_messages(tags) == 0 &&
+        tags[0].value.armMemoryRes.size != 0) {
+        end = tags[0].value.armMemoryRes.base +
+              tags[0].value.armMemoryRes.size;
+    }
+
+    uint8_t *rest = __end + HEAP_BOOT_SIZE;
+    if (end > (uintptr_t) rest) {
+        mem_add_pool(rest, end - (uintptr_t) rest);
+    }
+#endif
+}
+
+void mem_stats(MemStats *stats)
+{
+    stats->freeBytes = 0;
+    stats->largestFree = 0;
+    stats->freeBlocks = 0;
+    for (int fl = 0; fl < HEAP_FL_COUNT; ++fl) {
+        for (int sl = 0; sl < HEAP_SL_COUNT; ++sl) {
+            for (const HeapBlock *block = heapFree[fl][sl]; block != NULL;
+                 block = block->nextFree) {
+                const size_t size = heap_size(block) - HEAP_HEADER;
+                stats->freeBytes += size;
+                stats->freeBlocks++;
+                if (size > stats->largestFree) {
+                    stats->largestFree = size;
+                }
             }
         }
     }
+}
 
-    if (best == NULL) {
-        return best;
+void *MEM_SYMBOL(malloc)(size_t size)
+{
+    if (size == 0 || size > HEAP_MAX_REQUEST) {
+        return NULL;
+    }
+    size = heap_adjust(size);
+    HeapBlock *block = heap_find(size);
+    if (block == NULL) {
+        return NULL;
     }
+    heap_remove(block);
+    block->size &= ~(size_t) HEAP_FREE;
+    heap_trim(block, size);
+    return heap_payload(block);
+}
 
-    if (bestDiff > sizeof(HeapSegmentHeader) * 2) {
-        HeapSegmentHeader *oldNext = best->next;
-        best->next = (void *) best + size;
-        best->next->allocated = false;
-        best->next->size = best->size - size;
-        best->next->next = oldNext;
-        best->next->prev = best;
-        best->size = size;
+void *MEM_SYMBOL(aligned_alloc)(size_t alignment, size_t size)
+{
+    if (alignment <= HEAP_ALIGN) {
+        return MEM_SYMBOL(malloc)(size);
+    }
+    if ((alignment & (alignment - 1)) != 0 || alignment > HEAP_MAX_REQUEST ||
+        size == 0 || size > HEAP_MAX_REQUEST) {
+        return NULL;
     }
 
-    best->allocated = true;
+    // room to slide the payload up to the boundary and leave a free block
+    // in front of it
+    size = heap_adjust(size);
+    HeapBlock *block = heap_find(size + alignment + HEAP_MIN_BLOCK);
+    if (block == NULL) {
+        return NULL;
+    }
+    heap_remove(block);
+    block->size &= ~(size_t) HEAP_FREE;
 
-    return best + 1;
+    const uintptr_t payload = (uintptr_t) heap_payload(block);
+    uintptr_t aligned =
+        (payload + alignment - 1) & ~(uintptr_t) (alignment - 1);
+    if (aligned != payload) {
+        if (aligned - payload < HEAP_MIN_BLOCK) {
+            aligned += alignment;
+        }
+        // the block was free, so the one before it is in use and the gap
+        // does not need coalescing
+        HeapBlock *front = block;
+        const size_t gap = aligned - payload;
+        block = heap_block((void *) aligned);
+        block->prevPhys = front;
+        block->size = heap_size(front) - gap;
+        heap_next(block)->prevPhys = block;
+        front->size = gap | HEAP_FREE;
+        heap_insert(front);
+    }
+    heap_trim(block, size);
+    return heap_payload(block);
 }
 
-void free(void *ptr)
+void *MEM_SYMBOL(calloc)(size_t count, size_t size)
 {
-    HeapSegmentHeader *segment = ptr - sizeof(HeapSegmentHeader);
-    segment->allocated = false;
-    while (segment->prev != NULL && !segment->prev->allocated) {
-        segment->prev->next = segment->next;
-        segment->prev->size += segment->size;
-        segment = segment->prev;
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *ptr = MEM_SYMBOL(malloc)(count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void *MEM_SYMBOL(realloc)(void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return MEM_SYMBOL(malloc)(size);
+    }
+    if (size == 0) {
+        MEM_SYMBOL(free)(ptr);
+        return NULL;
+    }
+    if (size > HEAP_MAX_REQUEST) {
+        return NULL;
+    }
+
+    HeapBlock *block = heap_block(ptr);
+    const size_t want = heap_adjust(size);
+    const size_t have = heap_size(block);
+    if (want > have) {
+        // grow in place into a free neighbour, or move
+        HeapBlock *next = heap_next(block);
+        if (!(next->size & HEAP_FREE) || have + heap_size(next) < want) {
+            void *moved = MEM_SYMBOL(malloc)(size);
+            if (moved != NULL) {
+                memcpy(moved, ptr, have - HEAP_HEADER);
+                MEM_SYMBOL(free)(ptr);
+            }
+            return moved;
+        }
+        heap_remove(next);
+        block->size += heap_size(next);
+        heap_next(block)->prevPhys = block;
+    }
+    heap_trim(block, want);
+    return ptr;
+}
+
+void MEM_SYMBOL(free)(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    HeapBlock *block = heap_block(ptr);
+    block->size |= HEAP_FREE;
+
+    HeapBlock *next = heap_next(block);
+    if (next->size & HEAP_FREE) {
+        heap_remove(next);
+        block->size += heap_size(next);
     }
-    while (segment->next != NULL && !segment->next->allocated) {
-        segment->size += segment->next->size;
-        segment->next = segment->next->next;
+    HeapBlock *prev = block->prevPhys;
+    if (prev != NULL && (prev->size & HEAP_FREE)) {
+        heap_remove(prev);
+        prev->size += heap_size(block);
+        block = prev;
     }
+    heap_next(block)->prevPhys = block;
+    heap_insert(block);
 }
@@ -2,7 +2,40 @@
 #define MEM_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+// Host builds (-DMEM_HOST, see tools/allocbench.c) link next to libc, so the
+// allocator entry points get a prefix and the heap is a static array.
+#ifdef MEM_HOST
+#define MEM_SYMBOL(name) mem_host_##name
+
+void *mem_host_malloc(size_t size);
+void *mem_host_aligned_alloc(size_t alignment, size_t size);
+void *mem_host_calloc(size_t count, size_t size);
+void *mem_host_realloc(void *ptr, size_t size);
+void mem_host_free(void *ptr);
+#else
+#define MEM_SYMBOL(name) name
+#endif
+
+typedef struct {
+    // payload bytes in free blocks
+    size_t freeBytes;
+    size_t largestFree;
+    uint32_t freeBlocks;
+} MemStats;
+
+// Sets up the heap from the end of the image (__end in linker.ld) to the top
+// of the ARM memory reported by the firmware. Needs the MMU up for the
+// mailbox, so call it after mmu_init. Calling it again drops every
+// allocation.
 void mem_init(void);
 
+// Hands [start, start + size) to malloc. Pools are never merged with each
+// other.
+void mem_add_pool(void *start, size_t size);
+
+// Walks the free lists, for diagnostics only.
+void mem_stats(MemStats *stats);
+
 #endif  // MEM_H
@@ -0,0 +1,112 @@
+#include "mmu.h"
+
+#define SECTION_SIZE 0x00100000
+#define SECTION_COUNT 4096
+#define CACHE_LINE 32
+
+// section descriptor: full access from domain 0
+#define SECTION 0x00002
+#define SECTION_AP_FULL 0x00C00
+#define SECTION_XN 0x00010
+
+#define RAM_END 0x20000000
+#define PERIPHERAL_BASE 0x20000000
+#define PERIPHERAL_END 0x21000000
+
+// SCTLR bits
+#define SCTLR_MMU (1 << 0)
+#define SCTLR_DCACHE (1 << 2)
+#define SCTLR_BRANCH_PREDICTION (1 << 11)
+#define SCTLR_ICACHE (1 << 12)
+#define SCTLR_UNALIGNED (1 << 22)
+#define SCTLR_ARMV6_TABLES (1 << 23)
+
+static uint32_t g_pageTable[SECTION_COUNT] __attribute__((aligned(16384)));
+
+static inline void mmu_dsb(void)
+{
+    __asm__ volatile("mcr p15, 0, %0, c7, c10, 4" ::"r"(0) : "memory");
+}
+
+static inline void mmu_invalidate_tlb(void)
+{
+    __asm__ volatile("mcr p15, 0, %0, c8, c7, 0" ::"r"(0) : "memory");
+    mmu_dsb();
+    // flush the prefetch buffer
+    __asm__ volatile("mcr p15, 0, %0, c7, c5, 4" ::"r"(0) : "memory");
+}
+
+static uint32_t mmu_section(uint32_t index, uint32_t type)
+{
+    uint32_t entry = (index * SECTION_SIZE) | SECTION | SECTION_AP_FULL | type;
+    if (type == MMU_DEVICE || type == MMU_STRONGLY_ORDERED) {
+        entry |= SECTION_XN;
+    }
+    return entry;
+}
+
+void mmu_init(void)
+{
+    for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+        const uint32_t address = i * SECTION_SIZE;
+        uint32_t type = MMU_STRONGLY_ORDERED;
+        if (address < RAM_END) {
+            type = MMU_WRITE_BACK;
+        } else if (address >= PERIPHERAL_BASE && address < PERIPHERAL_END) {
+            type = MMU_DEVICE;
+        }
+        g_pageTable[i] = mmu_section(i, type);
+    }
+
+    // invalidate both caches and the TLBs before turning them on
+    __asm__ volatile("mcr p15, 0, %0, c7, c7, 0" ::"r"(0) : "memory");
+    mmu_invalidate_tlb();
+
+    // the table walk does not look into the caches, TTBCR = 0 uses TTBR0 for
+    // the whole address space and domain 0 is a client
+    __asm__ volatile("mcr p15, 0, %0, c2, c0, 0" ::"r"(g_pageTable)
+                     : "memory");
+    __asm__ volatile("mcr p15, 0, %0, c2, c0, 2" ::"r"(0));
+    __asm__ volatile("mcr p15, 0, %0, c3, c0, 0" ::"r"(1));
+
+    uint32_t control;
+    __asm__ volatile("mrc p15, 0, %0, c1, c0, 0" : "=r"(control));
+    control |= SCTLR_MMU | SCTLR_DCACHE | SCTLR_BRANCH_PREDICTION |
+               SCTLR_ICACHE | SCTLR_UNALIGNED | SCTLR_ARMV6_TABLES;
+    __asm__ volatile("mcr p15, 0, %0, c1, c0, 0" ::"r"(control) : "memory");
+    __asm__ volatile("mcr p15, 0, %0, c7, c5, 4" ::"r"(0) : "memory");
+}
+
+void mmu_map_region(uintptr_t base, size_t size, uint32_t type)
+{
+    const uint32_t first = base / SECTION_SIZE;
+    const uint32_t last = (base + size - 1) / SECTION_SIZE;
+    // write back and drop whatever the old mapping cached
+    __asm__ volatile("mcr p15, 0, %0, c7, c14, 0" ::"r"(0) : "memory");
+    for (uint32_t i = first; i <= last && i < SECTION_COUNT; ++i) {
+        g_pageTable[i] = mmu_section(i, type);
+    }
+    cache_clean_range(&g_pageTable[first],
+                      (last - first + 1) * sizeof(uint32_t));
+    mmu_invalidate_tlb();
+}
+
+void cache_clean_range(const void *start, size_t size)
+{
+    uintptr_t mva = (uintptr_t) start & ~(CACHE_LINE - 1);
+    const uintptr_t end = (uintptr_t) start + size;
+    for (; mva < end; mva += CACHE_LINE) {
+        __asm__ volatile("mcr p15, 0, %0, c7, c10, 1" ::"r"(mva) : "memory");
+    }
+    mmu_dsb();
+}
+
+void cache_invalidate_range(const void *start, size_t size)
+{
+    uintptr_t mva = (uintptr_t) start & ~(CACHE_LINE - 1);
+    const uintptr_t end = (uintptr_t) start + size;
+    for (; mva < end; mva += CACHE_LINE) {
+        __asm__ volatile("mcr p15, 0, %0, c7, c6, 1" ::"r"(mva) : "memory");
+    }
+    mmu_dsb();
+}
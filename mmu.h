@@ -0,0 +1,30 @@
+#ifndef MMU_H
+#define MMU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// memory types of a 1 MiB section, as ARMv6 TEX/C/B bits
+#define MMU_STRONGLY_ORDERED 0x00000
+#define MMU_DEVICE 0x00004
+#define MMU_WRITE_COMBINE 0x01000
+#define MMU_WRITE_BACK 0x0100C
+
+// Builds a flat identity mapping (RAM write-back cacheable, peripherals
+// device memory, everything else strongly ordered) and turns on the MMU,
+// both L1 caches and branch prediction. Call once at boot.
+void mmu_init(void);
+
+// Changes the memory type of the sections covering [base, base + size),
+// eg. to map the framebuffer write-combining.
+void mmu_map_region(uintptr_t base, size_t size, uint32_t type);
+
+// Writes dirty data cache lines of a buffer back to memory, before a device
+// such as the GPU reads it.
+void cache_clean_range(const void *start, size_t size);
+
+// Drops the data cache lines of a buffer, after a device wrote to it. Lines
+// are 32 bytes, anything sharing them must not be dirty.
+void cache_invalidate_range(const void *start, size_t size);
+
+#endif  // MMU_H
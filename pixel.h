@@ -0,0 +1,60 @@
+#pragma once
+
+// Operations on all four 8-bit channels of an ABGR8888 pixel at once. The
+// bare-metal build uses the ARMv6 SIMD instructions; elsewhere the channels
+// are packed into 32-bit arithmetic so no channel is unpacked on its own.
+
+#include <stdint.h>
+
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+// (channel * scalar) >> 8 for every channel, scalar from 0 to 256
+static inline uint32_t PixelScale(uint32_t scalar, uint32_t rgba)
+{
+#if defined(__ARM_FEATURE_SIMD32)
+    // UXTB16 splits off channels 0/2 and 1/3 into halfword lanes
+    const uint32_t even = __uxtb16(rgba) * scalar;
+    const uint32_t odd = __uxtb16(rgba >> 8) * scalar;
+    return __uxtb16(even >> 8) | (odd & 0xFF00FF00);
+#else
+    // two channels per multiply; 255 * 256 still fits a 16-bit lane
+    const uint32_t even = (rgba & 0x00FF00FF) * scalar;
+    const uint32_t odd = ((rgba >> 8) & 0x00FF00FF) * scalar;
+    return ((even >> 8) & 0x00FF00FF) | (odd & 0xFF00FF00);
+#endif
+}
+
+// PixelScale() of the colour channels, keeps alpha
+static inline uint32_t PixelScaleRgb(uint32_t scalar, uint32_t rgba)
+{
+    return (rgba & 0xFF000000) | (PixelScale(scalar, rgba) & 0x00FFFFFF);
+}
+
+// channel-wise sum, saturating at 255
+static inline uint32_t PixelAdd(uint32_t rgba1, uint32_t rgba2)
+{
+#if defined(__ARM_FEATURE_SIMD32)
+    return __uqadd8(rgba1, rgba2);
+#else
+    // add the low seven bits of every channel, then the top bit and its
+    // carry out by hand
+    const uint32_t low = (rgba1 & 0x7F7F7F7F) + (rgba2 & 0x7F7F7F7F);
+    const uint32_t carry =
+        ((rgba1 & rgba2) | ((rgba1 | rgba2) & low)) & 0x80808080;
+    const uint32_t sum = low ^ ((rgba1 ^ rgba2) & 0x80808080);
+    return sum | ((carry >> 7) * 0xFF);
+#endif
+}
+
+// halves the colour channels, keeps alpha
+static inline uint32_t PixelDarken(uint32_t rgba)
+{
+#if defined(__ARM_FEATURE_SIMD32)
+    // halving add with itself leaves alpha, with zero halves the rest
+    return __uhadd8(rgba, rgba & 0xFF000000);
+#else
+    return (rgba & 0xFF000000) | ((rgba >> 1) & 0x007F7F7F);
+#endif
+}
@@ -0,0 +1,127 @@
+#include "platform.h"
+
+#include "mailbox.h"
+#include "uart.h"
+
+char *itoa(int value, char *str, int base);
+
+// Returns 0 when the firmware does not answer.
+static uint32_t platform_clock_rate(uint32_t tag, uint32_t clockId)
+{
+    PropertyMessageTag tags[2];
+    tags[0].tag = tag;
+    tags[0].value.clockRateRes.clockId = clockId;
+    tags[0].value.clockRateRes.rate = 0;
+    tags[1].tag = NULL_TAG;
+    if (mailbox_send_messages(tags) != 0) {
+        return 0;
+    }
+    return tags[0].value.clockRateRes.rate;
+}
+
+// Current or maximum SoC temperature, 0 when the firmware does not answer.
+static uint32_t platform_temperature(uint32_t tag)
+{
+    PropertyMessageTag tags[2];
+    tags[0].tag = tag;
+    // the SoC is the only sensor
+    tags[0].value.temperatureRes.temperatureId = 0;
+    tags[0].value.temperatureRes.value = 0;
+    tags[1].tag = NULL_TAG;
+    if (mailbox_send_messages(tags) != 0) {
+        return 0;
+    }
+    return tags[0].value.temperatureRes.value;
+}
+
+// Sets both clocks and reads back what the firmware actually chose. The
+// PL011 runs off its own UART clock, so the baud rate survives this.
+static void platform_set_clocks(Platform *platform,
+                                uint32_t armRate,
+                                uint32_t coreRate)
+{
+    PropertyMessageTag tags[3];
+    tags[0].tag = CLOCK_SET_RATE;
+    tags[0].value.clockRateSetInfo.clockId = CLOCK_ID_ARM;
+    tags[0].value.clockRateSetInfo.rate = armRate;
+    // let the firmware raise the voltage for turbo rates
+    tags[0].value.clockRateSetInfo.skipTurbo = 0;
+    tags[1].tag = CLOCK_SET_RATE;
+    tags[1].value.clockRateSetInfo.clockId = CLOCK_ID_CORE;
+    tags[1].value.clockRateSetInfo.rate = coreRate;
+    tags[1].value.clockRateSetInfo.skipTurbo = 0;
+    tags[2].tag = NULL_TAG;
+    if (mailbox_send_messages(tags) == 0) {
+        platform->armRate = tags[0].value.clockRateRes.rate;
+        platform->coreRate = tags[1].value.clockRateRes.rate;
+    }
+}
+
+static void platform_put_number(const char *label,
+                                uint32_t value,
+                                const char *unit)
+{
+    char buf[16];
+    uart_puts(label);
+    uart_puts(itoa(value, buf, 10));
+    uart_puts(unit);
+}
+
+static void platform_report(const Platform *platform)
+{
+    platform_put_number("arm ", platform->armRate / 1000000, " MHz");
+    platform_put_number(" (max ", platform->armMax / 1000000, " MHz)");
+    platform_put_number(", core ", platform->coreRate / 1000000, " MHz");
+    platform_put_number(" (max ", platform->coreMax / 1000000, " MHz)");
+    platform_put_number(", ", platform->temperature / 1000, " C");
+    uart_puts(platform->throttled ? ", throttled\r\n" : "\r\n");
+}
+
+void platform_init(Platform *platform)
+{
+    platform->armBoot = platform_clock_rate(CLOCK_GET_RATE, CLOCK_ID_ARM);
+    platform->coreBoot = platform_clock_rate(CLOCK_GET_RATE, CLOCK_ID_CORE);
+    platform->armMax = platform_clock_rate(CLOCK_GET_MAX_RATE, CLOCK_ID_ARM);
+    platform->coreMax = platform_clock_rate(CLOCK_GET_MAX_RATE, CLOCK_ID_CORE);
+    platform->armRate = platform->armBoot;
+    platform->coreRate = platform->coreBoot;
+    platform->throttled = false;
+    platform->boosted = false;
+
+    uint32_t limit = platform_temperature(GET_MAX_TEMPERATURE);
+    if (limit == 0) {
+        limit = PLATFORM_TEMPERATURE_LIMIT;
+    }
+    platform->throttleAbove = limit - PLATFORM_THROTTLE_MARGIN;
+
+    // only with every rate known; the boot ones are what throttling restores
+    if (platform->armBoot != 0 && platform->coreBoot != 0 &&
+        platform->armMax != 0 && platform->coreMax != 0 &&
+        (platform->armMax > platform->armBoot ||
+         platform->coreMax > platform->coreBoot)) {
+        platform_set_clocks(platform, platform->armMax, platform->coreMax);
+        platform->boosted = true;
+    }
+    platform->temperature = platform_temperature(GET_TEMPERATURE);
+    platform_report(platform);
+}
+
+void platform_update(Platform *platform)
+{
+    const uint32_t temperature = platform_temperature(GET_TEMPERATURE);
+    if (temperature == 0 || !platform->boosted) {
+        return;
+    }
+    platform->temperature = temperature;
+    if (!platform->throttled && temperature > platform->throttleAbove) {
+        platform->throttled = true;
+        platform_set_clocks(platform, platform->armBoot, platform->coreBoot);
+        platform_report(platform);
+    } else if (platform->throttled &&
+               temperature + PLATFORM_THROTTLE_HYSTERESIS <
+                   platform->throttleAbove) {
+        platform->throttled = false;
+        platform_set_clocks(platform, platform->armMax, platform->coreMax);
+        platform_report(platform);
+    }
+}
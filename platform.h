@@ -0,0 +1,41 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Throttling starts this far below the firmware's temperature limit and
+// ends once the SoC has cooled this much further, in thousandths of a
+// degree Celsius.
+#define PLATFORM_THROTTLE_MARGIN 5000
+#define PLATFORM_THROTTLE_HYSTERESIS 10000
+// used when the firmware does not report its limit
+#define PLATFORM_TEMPERATURE_LIMIT 85000
+
+// Clock rates in Hz. The firmware boots the ARM and core clocks below their
+// maximum; the boot rates are kept to fall back to when the SoC runs hot.
+typedef struct {
+    uint32_t armRate;
+    uint32_t coreRate;
+    uint32_t armBoot;
+    uint32_t coreBoot;
+    uint32_t armMax;
+    uint32_t coreMax;
+    // last reading and throttling threshold, thousandths of a degree
+    uint32_t temperature;
+    uint32_t throttleAbove;
+    // clocks raised at boot, and since dropped back for the temperature
+    bool boosted;
+    bool throttled;
+} Platform;
+
+// Raises the ARM and core clocks to their maximum and reports the rates and
+// the temperature over the UART. Needs mem_init and uart_init first.
+void platform_init(Platform *platform);
+
+// Reads the temperature and drops back to the boot clocks above the
+// threshold, or boosts again once cooled. A mailbox round trip, so call it
+// every second or so rather than every frame.
+void platform_update(Platform *platform);
+
+#endif  // PLATFORM_H
@@ -0,0 +1,81 @@
+#include "profile.h"
+
+#include <string.h>
+
+#include "uart.h"
+
+// PMNC, the performance monitor control register
+#define PMNC_ENABLE (1 << 0)
+#define PMNC_RESET_COUNTERS (1 << 1)
+#define PMNC_RESET_CYCLES (1 << 2)
+#define PMNC_OVERFLOW_FLAGS (7 << 8)
+#define PMNC_EVENT0(n) ((n) << 20)
+#define PMNC_EVENT1(n) ((n) << 12)
+
+static ProfileRecord g_profileRecord;
+static ProfileCounters g_profileStart[PROFILE_STAGES];
+static bool g_profileStreaming;
+
+static inline void profile_read(ProfileCounters *counters)
+{
+    __asm__ volatile("mrc p15, 0, %0, c15, c12, 1" : "=r"(counters->cycles));
+    __asm__ volatile("mrc p15, 0, %0, c15, c12, 2"
+                     : "=r"(counters->dcacheMisses));
+    __asm__ volatile("mrc p15, 0, %0, c15, c12, 3"
+                     : "=r"(counters->branchMispredicts));
+}
+
+void profile_init(void)
+{
+    const uint32_t pmnc = PMNC_ENABLE | PMNC_RESET_COUNTERS |
+                          PMNC_RESET_CYCLES | PMNC_OVERFLOW_FLAGS |
+                          PMNC_EVENT0(PROFILE_EVENT_DCACHE_MISS) |
+                          PMNC_EVENT1(PROFILE_EVENT_BRANCH_MISPREDICT);
+    __asm__ volatile("mcr p15, 0, %0, c15, c12, 0" ::"r"(pmnc));
+    memcpy(g_profileRecord.magic, PROFILE_MAGIC, 2);
+    g_profileRecord.stages = PROFILE_STAGES;
+}
+
+void profile_begin(ProfileStage stage)
+{
+    profile_read(&g_profileStart[stage]);
+}
+
+void profile_end(ProfileStage stage)
+{
+    ProfileCounters now;
+    profile_read(&now);
+    // the counters wrap, unsigned differences stay right
+    ProfileCounters *total = &g_profileRecord.counters[stage];
+    total->cycles += now.cycles - g_profileStart[stage].cycles;
+    total->dcacheMisses +=
+        now.dcacheMisses - g_profileStart[stage].dcacheMisses;
+    total->branchMispredicts +=
+        now.branchMispredicts - g_profileStart[stage].branchMispredicts;
+}
+
+void profile_frame(void)
+{
+    if (g_profileStreaming) {
+        const uint8_t *bytes = (const uint8_t *) &g_profileRecord;
+        uint8_t sum = 0;
+        g_profileRecord.checksum = 0;
+        for (uint32_t i = 0; i < sizeof(g_profileRecord); ++i) {
+            sum += bytes[i];
+        }
+        g_profileRecord.checksum = sum;
+        uart_write(&g_profileRecord, sizeof(g_profileRecord));
+    }
+    g_profileRecord.frame++;
+    memset(g_profileRecord.counters, 0, sizeof(g_profileRecord.counters));
+}
+
+void profile_set_streaming(bool streaming)
+{
+    g_profileStreaming = streaming;
+}
+
+bool profile_streaming(void)
+{
+    return g_profileStreaming;
+}
@@ -0,0 +1,55 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Stages of a bare-metal frame, in the order they run.
+typedef enum {
+    PROFILE_WORLD,  // chunk streaming
+    PROFILE_TRACE,  // RendererTraceFrame
+    PROFILE_HUD,    // text overlay
+    PROFILE_COPY,   // waiting for the last DMA blit and the page flip
+    PROFILE_FILL,   // stretching rows into the staging buffer
+    PROFILE_MOVE,   // input and GameMove
+    PROFILE_STAGES
+} ProfileStage;
+
+// ARM1176 event numbers counted next to the cycles
+#define PROFILE_EVENT_BRANCH_MISPREDICT 0x06
+#define PROFILE_EVENT_DCACHE_MISS 0x0B
+
+typedef struct {
+    uint32_t cycles;
+    uint32_t dcacheMisses;
+    uint32_t branchMispredicts;
+} __attribute__((packed)) ProfileCounters;
+
+// One frame as streamed over the UART. The magic lets a reader find records
+// between text output, the checksum rejects false matches.
+#define PROFILE_MAGIC "PF"
+
+typedef struct {
+    char magic[2];
+    uint8_t stages;
+    // sum of all other bytes of the record
+    uint8_t checksum;
+    uint32_t frame;
+    ProfileCounters counters[PROFILE_STAGES];
+} __attribute__((packed)) ProfileRecord;
+
+// Enables the cycle counter and both event counters.
+void profile_init(void);
+
+void profile_begin(ProfileStage stage);
+
+void profile_end(ProfileStage stage);
+
+// Sends the record of this frame when streaming and starts the next one.
+void profile_frame(void);
+
+void profile_set_streaming(bool streaming);
+
+bool profile_streaming(void);
+
+#endif  // PROFILE_H
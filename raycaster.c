@@ -12,6 +12,7 @@ RayCaster *RayCasterConstruct(void)
         return NULL;
     }
     rayCaster->derived = NULL;
+    rayCaster->map = NULL;
 
     rayCaster->Start = NULL;
     rayCaster->Trace = NULL;
@@ -15,9 +15,6 @@
 #define LOOKUP8(tbl, offset) tbl[offset]
 #define LOOKUP16(tbl, offset) tbl[offset]
 
-#define MAP_X (uint8_t) 32
-#define MAP_XS (uint8_t) 5
-#define MAP_Y (uint8_t) 32
 #define INV_FACTOR_INT ((uint16_t) (SCREEN_WIDTH * 75))
 #define MIN_DIST (int) ((150 * ((float) SCREEN_WIDTH / (float) SCREEN_HEIGHT)))
 #define HORIZON_HEIGHT (SCREEN_HEIGHT >> 1)
@@ -25,9 +22,13 @@
 #define UMULT(x, y) (uint16_t)(((uint32_t) (x) * (uint32_t) (y)) >> 8)
 #define ABS(x) (x < 0 ? -x : x)
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+
+struct Map;
 
 typedef struct RayCaster {
     void *derived;
+    const struct Map *map;
 
     void (*Destruct)(struct RayCaster *rayCaster);
 
@@ -35,13 +36,16 @@ typedef struct RayCaster {
                   uint16_t playerX,
                   uint16_t playerY,
                   int16_t playerA);
+    // textureNo holds the hit side in bit 0 and the tile type above it
     void (*Trace)(struct RayCaster *rayCaster,
                   uint16_t screenX,
                   uint8_t *screenY,
                   uint8_t *textureNo,
                   uint8_t *textureX,
                   uint16_t *textureY,
-                  uint16_t *textureStep);
+                  uint16_t *textureStep,
+                  uint8_t *tileX,
+                  uint8_t *tileY);
 } RayCaster;
 
 RayCaster *RayCasterConstruct(void);
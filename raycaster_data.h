@@ -2,19 +2,26 @@
 
 #include <stdbool.h>
 
+#include "map.h"
 #include "raycaster.h"
 
+// dimensions of the built-in map
+#define MAP_X (uint8_t) 32
+#define MAP_XS (uint8_t) 5
+#define MAP_Y (uint8_t) 32
+
+#define TILE_TYPES 4
+
 extern const uint8_t LOOKUP_TBL g_map[128];
 
+extern const MapSpawn LOOKUP_TBL g_mapSpawn;
+
+extern const uint8_t LOOKUP_TBL g_tileMap[512];
+
+extern const uint32_t LOOKUP_TBL g_tileTint[TILE_TYPES];
+
+extern const uint8_t LOOKUP_TBL g_lightMap[1024];
+
 extern const uint32_t LOOKUP_TBL g_texture32[4096];
 
 extern const uint8_t LOOKUP_TBL g_font[128][16];
-
-static inline bool MapIsWall(uint8_t tileX, uint8_t tileY)
-{
-    if (tileX >= MAP_X - 1 || tileY >= MAP_Y - 1) {
-        return true;
-    }
-    return LOOKUP8(g_map, (tileX >> 3) + (tileY << (MAP_XS - 3))) &
-           (1 << (8 - (tileX & 0x7)));
-}
@@ -24,10 +24,12 @@ static void RayCasterFixedTrace(RayCaster *rayCaster,
                                 uint8_t *textureNo,
                                 uint8_t *textureX,
                                 uint16_t *textureY,
-                                uint16_t *textureStep);
+                                uint16_t *textureStep,
+                                uint8_t *hitTileX,
+                                uint8_t *hitTileY);
 static void RayCasterFixedDestruct(RayCaster *rayCaster);
 
-RayCaster *RayCasterFixedConstruct(void)
+RayCaster *RayCasterFixedConstruct(const Map *map)
 {
     RayCaster *rayCaster = RayCasterConstruct();
     RayCasterFixed *rayCasterFixed = malloc(sizeof(RayCasterFixed));
@@ -36,6 +38,7 @@ RayCaster *RayCasterFixedConstruct(void)
         return NULL;
     }
     rayCaster->derived = rayCasterFixed;
+    rayCaster->map = map;
 
     rayCaster->Start = RayCasterFixedStart;
     rayCaster->Trace = RayCasterFixedTrace;
@@ -45,25 +48,25 @@ RayCaster *RayCasterFixedConstruct(void)
 }
 
 // (v * f) >> 8
-static uint16_t RayCasterFixedMulU(uint8_t v, uint16_t f)
+static uint32_t RayCasterFixedMulU(uint8_t v, uint32_t f)
 {
-    const uint8_t f_h = f >> 8;
+    const uint32_t f_h = f >> 8;
     const uint8_t f_l = f % 256;
-    const uint16_t hm = v * f_h;
+    const uint32_t hm = v * f_h;
     const uint16_t lm = v * f_l;
     return hm + (lm >> 8);
 }
 
-static int16_t RayCasterFixedMulS(uint8_t v, int16_t f)
+static int32_t RayCasterFixedMulS(uint8_t v, int32_t f)
 {
-    const uint16_t uf = RayCasterFixedMulU(v, (uint16_t) ABS(f));
+    const int32_t uf = RayCasterFixedMulU(v, (uint32_t) ABS(f));
     if (f < 0) {
         return ~uf;
     }
     return uf;
 }
 
-static inline int16_t RayCasterFixedAbsTan(uint8_t quarter,
+static inline int32_t RayCasterFixedAbsTan(uint8_t quarter,
                                            uint8_t angle,
                                            const uint16_t *lookupTable)
 {
@@ -73,7 +76,7 @@ static inline int16_t RayCasterFixedAbsTan(uint8_t quarter,
     return LOOKUP16(lookupTable, angle);
 }
 
-static int16_t RayCasterFixedMulTan(uint8_t value,
+static int32_t RayCasterFixedMulTan(uint8_t value,
                                     bool inverse,
                                     uint8_t quarter,
                                     uint8_t angle,
@@ -118,18 +121,22 @@ static void RayCasterFixedLookupHeight(uint16_t distance,
     }
 }
 
-static void RayCasterFixedCalculateDistance(uint16_t rayX,
+static void RayCasterFixedCalculateDistance(const Map *map,
+                                            uint16_t rayX,
                                             uint16_t rayY,
                                             uint16_t rayA,
-                                            int16_t *deltaX,
-                                            int16_t *deltaY,
+                                            int32_t *deltaX,
+                                            int32_t *deltaY,
                                             uint8_t *textureNo,
-                                            uint8_t *textureX)
+                                            uint8_t *textureX,
+                                            uint8_t *hitTileX,
+                                            uint8_t *hitTileY)
 {
     int8_t tileStepX = 0;
     int8_t tileStepY = 0;
-    int16_t interceptX = rayX;
-    int16_t interceptY = rayY;
+    // 32 bits: intercepts and hits run past the 8.8 range on large maps
+    int32_t interceptX = rayX;
+    int32_t interceptY = rayY;
 
     const uint8_t quarter = rayA >> 8;
     const uint8_t angle = rayA % 256;
@@ -138,8 +145,8 @@ static void RayCasterFixedCalculateDistance(uint16_t rayX,
 
     uint8_t tileX = rayX >> 8;
     uint8_t tileY = rayY >> 8;
-    int16_t hitX;
-    int16_t hitY;
+    int32_t hitX;
+    int32_t hitY;
 
     if (angle == 0) {
         switch (quarter % 2) {
@@ -151,7 +158,7 @@ static void RayCasterFixedCalculateDistance(uint16_t rayX,
             }
             for (;;) {
                 tileY += tileStepY;
-                if (MapIsWall(tileX, tileY)) {
+                if (MapIsWall(map, tileX, tileY)) {
                     goto HorizontalHit;
                 }
             }
@@ -164,15 +171,15 @@ static void RayCasterFixedCalculateDistance(uint16_t rayX,
             }
             for (;;) {
                 tileX += tileStepX;
-                if (MapIsWall(tileX, tileY)) {
+                if (MapIsWall(map, tileX, tileY)) {
                     goto VerticalHit;
                 }
             }
             break;
         }
     } else {
-        int16_t stepX = 0;
-        int16_t stepY = 0;
+        int32_t stepX = 0;
+        int32_t stepY = 0;
 
         switch (quarter) {
         case 0:
@@ -214,7 +221,7 @@ static void RayCasterFixedCalculateDistance(uint16_t rayX,
             while ((tileStepY == 1 && (interceptY >> 8 < tileY)) ||
                    (tileStepY == -1 && (interceptY >> 8 >= tileY))) {
                 tileX += tileStepX;
-                if (MapIsWall(tileX, tileY)) {
+                if (MapIsWall(map, tileX, tileY)) {
                     goto VerticalHit;
                 }
                 interceptY += stepY;
@@ -222,7 +229,7 @@ static void RayCasterFixedCalculateDistance(uint16_t rayX,
             while ((tileStepX == 1 && (interceptX >> 8 < tileX)) ||
                    (tileStepX == -1 && (interceptX >> 8 >= tileX))) {
                 tileY += tileStepY;
-                if (MapIsWall(tileX, tileY)) {
+                if (MapIsWall(map, tileX, tileY)) {
                     goto HorizontalHit;
                 }
                 interceptX += stepX;
@@ -230,21 +237,26 @@ static void RayCasterFixedCalculateDistance(uint16_t rayX,
         }
     }
 
+    // stepping off the top or left edge wraps the tile around to 255, which
+    // MapIsWall() stops at; maps are at most 128 tiles wide, so read it as -1
 HorizontalHit:
     hitX = interceptX + (tileStepX == 1 ? 256 : 0);
-    hitY = (tileY << 8) + (tileStepY == -1 ? 256 : 0);
+    hitY = (int8_t) tileY * 256 + (tileStepY == -1 ? 256 : 0);
     *textureNo = 0;
     *textureX = interceptX & 0xFF;
     goto WallHit;
 
 VerticalHit:
-    hitX = (tileX << 8) + (tileStepX == -1 ? 256 : 0);
+    hitX = (int8_t) tileX * 256 + (tileStepX == -1 ? 256 : 0);
     hitY = interceptY + (tileStepY == 1 ? 256 : 0);
     *textureNo = 1;
     *textureX = interceptY & 0xFF;
     goto WallHit;
 
 WallHit:
+    *textureNo |= MapTileType(map, tileX, tileY) << 1;
+    *hitTileX = tileX;
+    *hitTileY = tileY;
     *deltaX = hitX - rayX;
     *deltaY = hitY - rayY;
 }
@@ -269,7 +281,9 @@ static void RayCasterFixedTrace(RayCaster *rayCaster,
                                 uint8_t *textureNo,
                                 uint8_t *textureX,
                                 uint16_t *textureY,
-                                uint16_t *textureStep)
+                                uint16_t *textureStep,
+                                uint8_t *hitTileX,
+                                uint8_t *hitTileY)
 {
     uint16_t rayAngle =
         (uint16_t) (((RayCasterFixed *) (rayCaster->derived))->playerA +
@@ -288,15 +302,16 @@ static void RayCasterFixedTrace(RayCaster *rayCaster,
     }
     rayAngle %= 1024;
 
-    int16_t deltaX;
-    int16_t deltaY;
+    int32_t deltaX;
+    int32_t deltaY;
     RayCasterFixedCalculateDistance(
-        ((RayCasterFixed *) (rayCaster->derived))->playerX,
+        rayCaster->map, ((RayCasterFixed *) (rayCaster->derived))->playerX,
         ((RayCasterFixed *) (rayCaster->derived))->playerY, rayAngle, &deltaX,
-        &deltaY, textureNo, textureX);
+        &deltaY, textureNo, textureX, hitTileX, hitTileY);
 
-    // distance = deltaY * cos(playerA) + deltaX * sin(playerA)
-    int16_t distance = 0;
+    // distance = deltaY * cos(playerA) + deltaX * sin(playerA), which is
+    // past 16 bits across a map more than 90 tiles wide
+    int32_t distance = 0;
     if (((RayCasterFixed *) (rayCaster->derived))->playerA == 0) {
         distance += deltaY;
     } else if (((RayCasterFixed *) (rayCaster->derived))->playerA == 512) {
@@ -1,4 +1,5 @@
 #pragma once
+#include "map.h"
 #include "raycaster.h"
 
-RayCaster *RayCasterFixedConstruct(void);
\ No newline at end of file
+RayCaster *RayCasterFixedConstruct(const Map *map);
\ No newline at end of file
@@ -19,9 +19,108 @@
 #include <math.h>
 #include <stdlib.h>
 
-#define P2P_DISTANCE(x1, y1, x2, y2)              \
-    sqrt((float) (((x1) - (x2)) * ((x1) - (x2)) + \
-                  ((y1) - (y2)) * ((y1) - (y2))))
+#if __STDC_HOSTED__
+#define FLOAT_SIN(a) sin(a)
+#define FLOAT_COS(a) cos(a)
+#define FLOAT_TAN(a) tan(a)
+#define FLOAT_ATAN(a) atanf(a)
+#define FLOAT_SQRT(a) sqrt(a)
+#define FLOAT_MODF(a, i) modff(a, i)
+#define FLOAT_MIN(a, b) fmin(a, b)
+#else
+// 裸機版本不連結 libm：三角函數以多項式近似，
+// 平方根使用 VFP 指令
+#define FLOAT_SIN(a) RayCasterFloatSin(a)
+#define FLOAT_COS(a) RayCasterFloatSin((a) + (float) M_PI_2)
+#define FLOAT_TAN(a) (RayCasterFloatSin(a) / FLOAT_COS(a))
+#define FLOAT_ATAN(a) RayCasterFloatAtan(a)
+#define FLOAT_SQRT(a) RayCasterFloatSqrt(a)
+#define FLOAT_MODF(a, i) RayCasterFloatModf(a, i)
+#define FLOAT_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// 函數：RayCasterFloatSin
+// 說明：先將角度歸約到 [-π/2, π/2]，
+//       再以泰勒級數展開到 x^11，誤差小於 1e-7
+static float RayCasterFloatSin(float a)
+{
+    while (a > (float) M_PI) {
+        a -= 2.0f * (float) M_PI;
+    }
+    while (a < (float) -M_PI) {
+        a += 2.0f * (float) M_PI;
+    }
+    // sin(π - a) = sin(a)
+    if (a > (float) M_PI_2) {
+        a = (float) M_PI - a;
+    } else if (a < (float) -M_PI_2) {
+        a = (float) -M_PI - a;
+    }
+    const float a2 = a * a;
+    return a * (1.0f +
+                a2 * (-1.0f / 6 +
+                      a2 * (1.0f / 120 +
+                            a2 * (-1.0f / 5040 +
+                                  a2 * (1.0f / 362880 +
+                                        a2 * (-1.0f / 39916800))))));
+}
+
+// 函數：RayCasterFloatAtan
+// 說明：|x| <= 1 時使用極小化最大誤差多項式
+//       （誤差約 2e-6 弧度），其餘利用 atan(x) = ±π/2 - atan(1/x)
+static float RayCasterFloatAtan(float x)
+{
+    if (x > 1.0f) {
+        return (float) M_PI_2 - RayCasterFloatAtan(1.0f / x);
+    }
+    if (x < -1.0f) {
+        return (float) -M_PI_2 - RayCasterFloatAtan(1.0f / x);
+    }
+    const float x2 = x * x;
+    return x * (0.99997726f +
+                x2 * (-0.33262347f +
+                      x2 * (0.19354346f +
+                            x2 * (-0.11643287f +
+                                  x2 * (0.05265332f + x2 * -0.01172120f)))));
+}
+
+// 函數：RayCasterFloatSqrt
+// 說明：有 VFP 時為單一指令；軟體浮點時以牛頓法逼近
+static float RayCasterFloatSqrt(float x)
+{
+#ifdef __ARM_FP
+    float root;
+    __asm__("vsqrt.f32 %0, %1" : "=t"(root) : "t"(x));
+    return root;
+#else
+    if (x <= 0) {
+        return 0;
+    }
+    union {
+        float f;
+        uint32_t u;
+    } guess = {x};
+    // 指數減半作為初始值
+    guess.u = (guess.u >> 1) + 0x1FC00000;
+    float root = guess.f;
+    for (int i = 0; i < 4; i++) {
+        root = 0.5f * (root + x / root);
+    }
+    return root;
+#endif
+}
+
+// 函數：RayCasterFloatModf
+// 說明：同 modff，向零截斷；座標遠小於 2^31
+static float RayCasterFloatModf(float x, float *whole)
+{
+    *whole = (float) (int32_t) x;
+    return x - *whole;
+}
+#endif
+
+#define P2P_DISTANCE(x1, y1, x2, y2)                    \
+    FLOAT_SQRT((float) (((x1) - (x2)) * ((x1) - (x2)) + \
+                        ((y1) - (y2)) * ((y1) - (y2))))
 
 // 定義結構，表示浮點數光線追踪器的狀態
 typedef struct {
@@ -39,6 +138,8 @@ typedef struct {
 //       textureX - 貼圖中的 x 座標（輸出）
 //       textureY - 貼圖中的 y 座標（輸出）
 //       textureStep - 貼圖步進（輸出）
+//       tileX - 命中格子的 x 座標（輸出）
+//       tileY - 命中格子的 y 座標（輸出）
 // 說明：跟蹤光線，計算並輸出螢幕上的相應數據
 static void RayCasterFloatTrace(RayCaster *rayCaster,
                                 uint16_t screenX,
@@ -46,7 +147,9 @@ static void RayCasterFloatTrace(RayCaster *rayCaster,
                                 uint8_t *textureNo,
                                 uint8_t *textureX,
                                 uint16_t *textureY,
-                                uint16_t *textureStep);
+                                uint16_t *textureStep,
+                                uint8_t *tileX,
+                                uint8_t *tileY);
 // 內部函數：RayCasterFloatStart
 // 參數：rayCaster - 光線追踪器
 //       playerX - 玩家在 x 軸上的位置
@@ -63,9 +166,10 @@ static void RayCasterFloatStart(RayCaster *rayCaster,
 static void RayCasterFloatDestruct(RayCaster *rayCaster);
 
 // 函數：RayCasterFloatConstruct
+// 參數：map - 光線追踪的地圖
 // 返回：RayCaster* - 光線追踪器結構指針
 // 說明：創建浮點光線追踪器實例
-RayCaster *RayCasterFloatConstruct(void)
+RayCaster *RayCasterFloatConstruct(const Map *map)
 {
     // 創建基本光線追踪器實例
     RayCaster *rayCaster = RayCasterConstruct();
@@ -77,6 +181,7 @@ RayCaster *RayCasterFloatConstruct(void)
         return NULL;
     }
     rayCaster->derived = rayCasterFloat;
+    rayCaster->map = map;
 
     // 設置函數指針
     rayCaster->Start = RayCasterFloatStart;
@@ -87,43 +192,50 @@ RayCaster *RayCasterFloatConstruct(void)
 }
 
 // 內部函數：RayCasterFloatIsWall
-// 參數：rayX - 光線的 x 座標
+// 參數：map - 地圖
+//       rayX - 光線的 x 座標
 //       rayY - 光線的 y 座標
 // 返回：如果光線碰到牆壁，返回 true；否則返回 false
 // 說明：檢查光線是否碰到牆壁
-static bool RayCasterFloatIsWall(float rayX, float rayY)
+static bool RayCasterFloatIsWall(const Map *map, float rayX, float rayY)
 {
     // 將浮點坐標轉換為地圖格子坐標
     float mapX = 0;
     float mapY = 0;
-    modff(rayX, &mapX);
-    modff(rayY, &mapY);
+    FLOAT_MODF(rayX, &mapX);
+    FLOAT_MODF(rayY, &mapY);
     int tileX = (int) mapX;
     int tileY = (int) mapY;
 
     // 檢查是否超出地圖邊界
-    if (tileX < 0 || tileY < 0 || tileX >= MAP_X - 1 || tileY >= MAP_Y - 1) {
+    if (tileX < 0 || tileY < 0 || tileX >= map->width - 1 ||
+        tileY >= map->height - 1) {
         return true;
     }
 
     // 檢查格子中的位是否為牆壁
-    return g_map[(tileX >> 3) + (tileY << (MAP_XS - 3))] &
-           (1 << (8 - (tileX & 0x7)));
+    return MapIsWall(map, tileX, tileY);
 }
 
 // 函數：RayCasterFloatDistance
-// 參數：playerX - 玩家的X座標
+// 參數：map - 地圖
+//       playerX - 玩家的X座標
 //       playerY - 玩家的Y座標
 //       rayA - 光線的角度
 //       hitOffset - 命中點的偏移量
 //       hitDirection - 命中的方向（垂直或水平）
+//       hitTileX - 命中格子的 x 座標
+//       hitTileY - 命中格子的 y 座標
 // 返回：命中點到玩家的距離
 // 說明：計算光線與牆壁的交點，並返回命中點到玩家的距離
-static float RayCasterFloatDistance(float playerX,
+static float RayCasterFloatDistance(const Map *map,
+                                    float playerX,
                                     float playerY,
                                     float rayA,
                                     float *hitOffset,
-                                    int *hitDirection)
+                                    int *hitDirection,
+                                    uint8_t *hitTileX,
+                                    uint8_t *hitTileY)
 {
     // 角度正規化，確保在0到2π之間
     while (rayA < 0) {
@@ -135,24 +247,25 @@ static float RayCasterFloatDistance(float playerX,
 
     // 計算光線的斜率和垂直斜率
     // 計算tan和cot值
-    float tanA = tan(rayA);
+    float tanA = FLOAT_TAN(rayA);
     float cotA = 1 / tanA;
     float rayX, rayY, vx, vy;
     float xOffset, yOffset, vertHitDis, horiHitDis;
     int depth = 0;
     // 射線尋找牆壁的最大嘗試次數
-    const int maxDepth = 100;
+    // 光線最多穿過地圖寬或高那麼多條格線就會碰到邊界
+    const int maxDepth = MAX(map->width, map->height);
 
     // 檢查垂直方向的射線
     depth = 0;
     vertHitDis = 0;
-    if (sin(rayA) > 0.001) {
+    if (FLOAT_SIN(rayA) > 0.001) {
         // 射線向右
         rayX = (int) playerX + 1;
         rayY = (rayX - playerX) * cotA + playerY;
         xOffset = 1;
         yOffset = xOffset * cotA;
-    } else if (sin(rayA) < -0.001) {
+    } else if (FLOAT_SIN(rayA) < -0.001) {
         // 射線向左
         rayX = (int) playerX - 0.001;
         rayY = (rayX - playerX) * cotA + playerY;
@@ -169,7 +282,7 @@ static float RayCasterFloatDistance(float playerX,
 
     // 尋找垂直方向的牆壁
     while (depth < maxDepth) {
-        if (RayCasterFloatIsWall(rayX, rayY)) {
+        if (RayCasterFloatIsWall(map, rayX, rayY)) {
             vertHitDis = P2P_DISTANCE(playerX, playerY, rayX, rayY);
             break;
         } else {
@@ -184,13 +297,13 @@ static float RayCasterFloatDistance(float playerX,
     // 檢查水平方向的命中
     depth = 0;
     horiHitDis = 0;
-    if (cos(rayA) > 0.001) {
+    if (FLOAT_COS(rayA) > 0.001) {
         // 射線向上
         rayY = (int) playerY + 1;
         rayX = (rayY - playerY) * tanA + playerX;
         yOffset = 1;
         xOffset = yOffset * tanA;
-    } else if (cos(rayA) < -0.001) {
+    } else if (FLOAT_COS(rayA) < -0.001) {
         // 射線向下
         rayY = (int) playerY - 0.001;
         rayX = (rayY - playerY) * tanA + playerX;
@@ -207,7 +320,7 @@ static float RayCasterFloatDistance(float playerX,
 
     // 尋找水平方向的牆壁
     while (depth < maxDepth) {
-        if (RayCasterFloatIsWall(rayX, rayY)) {
+        if (RayCasterFloatIsWall(map, rayX, rayY)) {
             horiHitDis = P2P_DISTANCE(playerX, playerY, rayX, rayY);
             break;
         } else {
@@ -229,9 +342,11 @@ static float RayCasterFloatDistance(float playerX,
         *hitDirection = false;
         *hitOffset = rayX;
     }
+    *hitTileX = (uint8_t) (int) rayX;
+    *hitTileY = (uint8_t) (int) rayY;
 
     // 返回光線撞擊點到玩家位置的最小距離
-    return fmin(vertHitDis, horiHitDis);
+    return FLOAT_MIN(vertHitDis, horiHitDis);
 }
 
 // 函數：RayCasterFloatTrace
@@ -242,6 +357,8 @@ static float RayCasterFloatDistance(float playerX,
 //       textureX - 紋理 x 坐標
 //       textureY - 紋理 y 坐標
 //       textureStep - 紋理步進值
+//       tileX - 命中格子的 x 座標
+//       tileY - 命中格子的 y 座標
 // 說明：對浮點數光線追踪進行一次追踪，計算光線與牆面的交點及相關資訊
 static void RayCasterFloatTrace(RayCaster *rayCaster,
                                 uint16_t screenX,
@@ -249,29 +366,33 @@ static void RayCasterFloatTrace(RayCaster *rayCaster,
                                 uint8_t *textureNo,
                                 uint8_t *textureX,
                                 uint16_t *textureY,
-                                uint16_t *textureStep)
+                                uint16_t *textureStep,
+                                uint8_t *tileX,
+                                uint8_t *tileY)
 {
     float hitOffset;
     int hitDirection;
 
     // 計算光線的角度差
     // 計算視點到屏幕上每個像素的距離和方向
-    float deltaAngle = atanf(((int16_t) screenX - SCREEN_WIDTH / 2.0f) /
-                             (SCREEN_WIDTH / 2.0f) * M_PI / 4);
+    float deltaAngle = FLOAT_ATAN(((int16_t) screenX - SCREEN_WIDTH / 2.0f) /
+                                  (SCREEN_WIDTH / 2.0f) * M_PI / 4);
 
     // 使用浮點數距離函數計算光線的距離、偏移和方向
     float lineDistance = RayCasterFloatDistance(
-        ((RayCasterFloat *) (rayCaster->derived))->playerX,
+        rayCaster->map, ((RayCasterFloat *) (rayCaster->derived))->playerX,
         ((RayCasterFloat *) (rayCaster->derived))->playerY,
         ((RayCasterFloat *) (rayCaster->derived))->playerA + deltaAngle,
-        &hitOffset, &hitDirection);
+        &hitOffset, &hitDirection, tileX, tileY);
 
     // 計算實際牆面距離
     // 計算真實距離（distance）和材質映射坐標（textureX）
-    float distance = lineDistance * cos(deltaAngle);
+    float distance = lineDistance * FLOAT_COS(deltaAngle);
     float dum;
-    *textureX = (uint8_t) (256.0f * modff(hitOffset, &dum));
-    *textureNo = hitDirection;
+    *textureX = (uint8_t) (256.0f * FLOAT_MODF(hitOffset, &dum));
+    // 最低位為命中方向，其餘為命中格子的牆面類型
+    *textureNo = hitDirection |
+                 (MapTileType(rayCaster->map, *tileX, *tileY) << 1);
     *textureY = 0;
     *textureStep = 0;
 
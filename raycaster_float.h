@@ -2,4 +2,4 @@
 #include "raycaster.h"
 #include "raycaster_data.h"
 
-RayCaster *RayCasterFloatConstruct(void);
+RayCaster *RayCasterFloatConstruct(const Map *map);
@@ -1,82 +1,825 @@
 #include "renderer.h"
 #include <math.h>
 #include <stdlib.h>
+#include "arena.h"
+#include "pixel.h"
 #include "raycaster_data.h"
+#include "raycaster_tables.h"
+#include "shade.h"
 
-#define MULT_SCALAR_RGBA(scalar, rgba)                      \
-    (((uint8_t) UMULT(scalar, (rgba >> 24) & 0xFF) << 24) | \
-     ((uint8_t) UMULT(scalar, (rgba >> 16) & 0xFF) << 16) | \
-     ((uint8_t) UMULT(scalar, (rgba >> 8) & 0xFF) << 8) |   \
-     ((uint8_t) UMULT(scalar, (rgba >> 0) & 0xFF) << 0))
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RENDERER_PACKET 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RENDERER_PACKET 4
+#endif
 
-#define ADD_RGBA(rgba1, rgba2)                                     \
-    ((((uint8_t) (rgba1 >> 24) + (uint8_t) (rgba2 >> 24)) << 24) | \
-     (((uint8_t) (rgba1 >> 16) + (uint8_t) (rgba2 >> 16)) << 16) | \
-     (((uint8_t) (rgba1 >> 8) + (uint8_t) (rgba2 >> 8)) << 8) |    \
-     (((uint8_t) (rgba1 >> 0) + (uint8_t) (rgba2 >> 0)) << 0))
+// distance-to-tile factor of the tangent at the screen edges (pi / 4)
+#define EDGE_TAN 201
+
+// shade ramps of every tile type's wall texture for the lit (0) and
+// shadowed (1) side
+static uint32_t g_wallShades[TILE_TYPES][2][SHADE_LEVELS][4096];
+// shade ramps of the 64x64 floor (0) and ceiling (1) textures
+static uint32_t g_flatShades[2][SHADE_LEVELS][4096];
+// shade level of a wall by its full-resolution half height
+static uint8_t g_heightShade[256];
+static bool g_shadesBuilt = false;
+
+static void RendererBuildShades(void)
+{
+    for (int v = 0; v < 64; v++) {
+        for (int u = 0; u < 64; u++) {
+            // floor: 16x16 checker tiles with dark grout lines
+            uint32_t floor =
+                ((u >> 4) + (v >> 4)) & 1 ? 0xFF53769B : 0xFF44617F;
+            if ((u & 15) == 0 || (v & 15) == 0) {
+                floor = 0xFF2A3A4C;
+            }
+            // ceiling: 32x32 panels with a light frame
+            uint32_t ceiling = 0xFFB0B0B0;
+            if ((u & 31) == 0 || (v & 31) == 0) {
+                ceiling = 0xFF707070;
+            } else if ((u & 31) == 1 || (v & 31) == 1) {
+                ceiling = 0xFFD0D0D0;
+            }
+            g_flatShades[0][0][(v << 6) + u] = floor;
+            g_flatShades[1][0][(v << 6) + u] = ceiling;
+        }
+    }
+    ShadeBuildRamp(g_flatShades[0], g_flatShades[0][0], false);
+    ShadeBuildRamp(g_flatShades[1], g_flatShades[1][0], false);
+    for (int t = 0; t < TILE_TYPES; t++) {
+        uint32_t *texture = g_wallShades[t][0][0];
+        ShadeTint(texture, g_texture32, g_tileTint[t]);
+        ShadeBuildRamp(g_wallShades[t][0], texture, false);
+        ShadeBuildRamp(g_wallShades[t][1], texture, true);
+    }
+
+    g_heightShade[0] = SHADE_LEVELS - 1;
+    for (int h = 1; h < 256; h++) {
+        g_heightShade[h] = ShadeLevel(INV_FACTOR_INT / h);
+    }
+    g_shadesBuilt = true;
+}
 
 Renderer RendererConstruct(RayCaster *rc)
 {
     Renderer renderer;
     renderer.rc = rc;
+    renderer.interleaved = false;
+    renderer.historyValid = false;
+    renderer.frame = 0;
+    renderer.flats = false;
+    renderer.lighting = false;
+    if (!g_shadesBuilt) {
+        RendererBuildShades();
+    }
+    RendererSetTextures(&renderer, NULL, 0);
+    RendererSetResolution(&renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
     return renderer;
 }
 
-void RendererTraceFrame(Renderer *renderer, Game *g, uint32_t *fb)
+void RendererSetRayCaster(Renderer *renderer, RayCaster *rc)
 {
-    renderer->rc->Start(renderer->rc, g->playerX, g->playerY, g->playerA);
+    renderer->rc = rc;
+    renderer->historyValid = false;
+}
+
+void RendererSetResolution(Renderer *renderer, uint16_t width, uint16_t height)
+{
+    if (width == 0 || width > SCREEN_WIDTH) {
+        width = SCREEN_WIDTH;
+    }
+    // keep the height even so both wall halves meet at the horizon
+    height &= ~1;
+    if (height == 0 || height > SCREEN_HEIGHT) {
+        height = SCREEN_HEIGHT;
+    }
+    renderer->width = width;
+    renderer->height = height;
+    renderer->columnStep = (SCREEN_WIDTH << 8) / width;
+    renderer->rowStep = (SCREEN_HEIGHT << 8) / height;
+    renderer->rowScale = (height << 8) / SCREEN_HEIGHT;
+    renderer->historyValid = false;
+
+    const uint16_t horizon = height >> 1;
+    for (int y = 0; y < horizon; y++) {
+        const uint16_t fy = (y * renderer->rowStep) >> 8;
+        renderer->background[y] =
+            PixelAdd(PixelScale(96 + (HORIZON_HEIGHT - fy), 0xFFFFB380),
+                     PixelScale(255 - (96 + (HORIZON_HEIGHT - fy)),
+                                0xFFFFFFFF));
+    }
+    // distance of the floor seen at the centre of each row below the
+    // horizon, from the same height = INV_FACTOR_INT / distance relation as
+    // the wall tables
+    for (int r = 0; r < horizon; r++) {
+        renderer->flatDistance[r] = ((uint32_t) INV_FACTOR_INT << 9) /
+                                    ((2 * r + 1) * renderer->rowStep);
+        renderer->flatShade[r] = ShadeLevel(renderer->flatDistance[r]);
+    }
+    for (int y = horizon; y < height; y++) {
+        const uint16_t fy = ((height - y) * renderer->rowStep) >> 8;
+        renderer->background[y] =
+            PixelAdd(PixelScale(96 + (HORIZON_HEIGHT - fy), 0xFF53769B),
+                     PixelScale(255 - (96 + (HORIZON_HEIGHT - fy)),
+                                0xFFFFFFFF));
+    }
+}
 
-    for (int x = 0; x < SCREEN_WIDTH; x++) {
-        uint8_t sso;
-        uint8_t tc;
-        uint8_t tn;
-        uint16_t tso;
-        uint16_t tst;
-        uint32_t *lb = fb + x;
+void RendererSetFlats(Renderer *renderer, bool flats)
+{
+    renderer->flats = flats;
+}
 
-        renderer->rc->Trace(renderer->rc, x, &sso, &tn, &tc, &tso, &tst);
+void RendererSetTextures(Renderer *renderer,
+                         const uint32_t *wallShades,
+                         uint16_t wallTypes)
+{
+    if (wallShades == NULL || wallTypes == 0) {
+        wallShades = g_wallShades[0][0][0];
+        wallTypes = TILE_TYPES;
+    }
+    renderer->wallShades = wallShades;
+    renderer->wallTypes = wallTypes;
+}
+
+void RendererSetLighting(Renderer *renderer, bool lighting)
+{
+    renderer->lighting = lighting;
+}
 
-        const int tx = (int) (tc >> 2);
-        int16_t ws = HORIZON_HEIGHT - sso;
-        if (ws < 0) {
-            ws = 0;
-            sso = HORIZON_HEIGHT;
+void RendererSetInterleaved(Renderer *renderer, bool interleaved)
+{
+    renderer->interleaved = interleaved;
+    renderer->historyValid = false;
+}
+
+static void RendererTraceColumn(Renderer *renderer,
+                                uint16_t x,
+                                RendererColumn *column)
+{
+    uint8_t tileX;
+    uint8_t tileY;
+    renderer->rc->Trace(renderer->rc, (x * renderer->columnStep) >> 8,
+                        &column->sso, &column->tn, &column->tc, &column->tso,
+                        &column->tst, &tileX, &tileY);
+    column->light = MapLight(renderer->rc->map, tileX, tileY);
+}
+
+// Shaded copy of the wall texture a column samples from: tile type and
+// wall side pick the ramp, distance plus the light map of the hit tile
+// the level.
+static const uint32_t *RendererColumnTexture(const Renderer *renderer,
+                                             const RendererColumn *column)
+{
+    uint8_t type = column->tn >> 1;
+    uint8_t level = 0;
+    if (type >= renderer->wallTypes) {
+        type = 0;
+    }
+    if (renderer->lighting) {
+        level = MIN(g_heightShade[column->sso] + column->light,
+                    SHADE_LEVELS - 1);
+    }
+    return renderer->wallShades +
+           ((((type << 1) + (column->tn & 1)) * SHADE_LEVELS + level) << 12);
+}
+
+// ray angle of column x relative to the view direction, in [-512, 512)
+static int16_t RendererColumnAngle(const Renderer *renderer, uint16_t x)
+{
+    const int16_t angle =
+        LOOKUP16(g_deltaAngle, (x * renderer->columnStep) >> 8);
+    return angle >= 512 ? angle - 1024 : angle;
+}
+
+// GameDirection() with 256 for 1.0, which the 8-bit tables wrap to 0 on
+// the axes
+static void RendererDirection(const Game *g, int16_t *sine, int16_t *cosine)
+{
+    GameDirection(g, sine, cosine);
+    if (*sine == 0 && *cosine == 0) {
+        switch (g->playerA >> 8) {
+        case 0:
+            *cosine = 256;
+            break;
+        case 1:
+            *sine = 256;
+            break;
+        case 2:
+            *cosine = -256;
+            break;
+        case 3:
+            *sine = -256;
+            break;
         }
-        uint16_t to = tso;
-        uint16_t ts = tst;
+    }
+}
 
-        for (int y = 0; y < ws; y++) {
-            *lb = ADD_RGBA(
-                MULT_SCALAR_RGBA(96 + (HORIZON_HEIGHT - y), 0xFFFFB380),
-                MULT_SCALAR_RGBA(255 - (96 + (HORIZON_HEIGHT - y)),
-                                 0xFFFFFFFF));
-            lb += SCREEN_WIDTH;
+// Finds the column of the previous frame whose ray matches column x after a
+// pure rotation. *source walks forward across calls since the angles grow
+// monotonically with x.
+static const RendererColumn *RendererReprojectColumn(const Renderer *renderer,
+                                                     uint16_t x,
+                                                     int16_t rotation,
+                                                     uint8_t parity,
+                                                     int *source)
+{
+    const int16_t target = RendererColumnAngle(renderer, x) + rotation;
+    while (*source < renderer->width &&
+           RendererColumnAngle(renderer, *source) < target) {
+        (*source)++;
+    }
+    for (int i = *source; i < renderer->width &&
+                          RendererColumnAngle(renderer, i) == target;
+         i++) {
+        // only the columns traced last frame hold last frame's rays
+        if ((i & 1) != parity) {
+            return &renderer->columns[i];
         }
+    }
+    return NULL;
+}
 
-        for (int y = 0; y < sso * 2; y++) {
-            // paint texture pixel
-            int ty = (int) (to >> 10);
-            uint32_t tv = g_texture32[(ty << 6) + tx];
+// A column of the previous frame moved into the current view, with its
+// new depth; depth 0 marks a column nothing landed on.
+typedef struct {
+    RendererColumn column;
+    uint16_t depth;
+} RendererProjection;
 
-            to += ts;
+// Moves last frame's columns along with a moving player. Each hit point is
+// rebuilt from the column's depth and ray angle in the previous pose,
+// projected into the view of g and handed to the nearest column of the
+// parity this frame does not trace; the nearer wall wins where two land on
+// the same one. Returns NULL without scratch memory.
+static RendererProjection *RendererReprojectMotion(const Renderer *renderer,
+                                                   const Game *g,
+                                                   uint8_t parity)
+{
+    const uint16_t width = renderer->width;
+    RendererProjection *projected =
+        FrameArenaAlloc(&g_frameArena, width * sizeof(RendererProjection));
+    if (!projected) {
+        return NULL;
+    }
+    for (int x = 0; x < width; x++) {
+        projected[x].depth = 0;
+    }
+
+    const Game *last = &renderer->history;
+    int16_t lastSine, lastCosine, sine, cosine;
+    RendererDirection(last, &lastSine, &lastCosine);
+    RendererDirection(g, &sine, &cosine);
+
+    for (int i = parity ^ 1; i < width; i += 2) {
+        const RendererColumn *column = &renderer->columns[i];
+        if (column->tst == 0) {
+            continue;
+        }
+        // the texture step covers 64 texels over the full wall height of
+        // INV_FACTOR_INT / depth pixels either side of the horizon, so it
+        // gives the depth even where the wall is clipped
+        const int32_t depth =
+            ((uint32_t) INV_FACTOR_INT * column->tst) >> 15;
+        if (depth == 0) {
+            continue;
+        }
+        // tangent of the ray angle, 16.16, from the same screen mapping the
+        // projection below inverts rather than the coarser angle table
+        const int32_t tangent =
+            (((int32_t) ((i * renderer->columnStep) >> 8) - SCREEN_WIDTH / 2) *
+             (EDGE_TAN << 8)) /
+            (SCREEN_WIDTH / 2);
+        const int32_t lateral = ((int64_t) depth * tangent) >> 16;
 
-            if (tn == 1 && tv > 0) {
-                // dark wall
-                tv = ((uint8_t) (tv >> 24) << 24) |
-                     (((uint8_t) (tv >> 16) >> 1) << 16) |
-                     (((uint8_t) (tv >> 8) >> 1) << 8) |
-                     (((uint8_t) (tv >> 0) >> 1) << 0);
+        // hit point relative to the new position, 16.16 tiles
+        const int64_t dx = ((int32_t) last->playerX << 8) +
+                           depth * lastSine + lateral * lastCosine -
+                           ((int32_t) g->playerX << 8);
+        const int64_t dy = ((int32_t) last->playerY << 8) +
+                           depth * lastCosine - lateral * lastSine -
+                           ((int32_t) g->playerY << 8);
+        // in the new view, 16.16 tiles
+        const int64_t forwardFine = (dx * sine + dy * cosine) >> 8;
+        const int64_t rightFine = (dx * cosine - dy * sine) >> 8;
+        const int32_t forward = forwardFine >> 8;
+        if (forward < MIN_DIST / 4) {
+            continue;
+        }
+
+        // full-resolution screen column times 256, then the nearest
+        // untraced internal column
+        const int64_t screenX = ((int64_t) (SCREEN_WIDTH / 2) << 8) +
+                                rightFine * (SCREEN_WIDTH / 2) * 65536 /
+                                    (forwardFine * EDGE_TAN);
+        if (screenX < 0) {
+            continue;
+        }
+        int x = screenX / renderer->columnStep;
+        if ((x & 1) == parity) {
+            x += (screenX % renderer->columnStep) * 2 >= renderer->columnStep
+                     ? 1
+                     : -1;
+        }
+        if (x < 0 || x >= width ||
+            (projected[x].depth && projected[x].depth <= forward)) {
+            continue;
+        }
+
+        // the step grows and the height shrinks with the depth
+        const uint32_t step = (uint32_t) column->tst * forward / depth;
+        if (step == 0 || step > 0xFFFF) {
+            continue;
+        }
+        const uint32_t height = 32768 / step;
+        RendererColumn *moved = &projected[x].column;
+        *moved = *column;
+        moved->tst = step;
+        if (height >= HORIZON_HEIGHT) {
+            moved->sso = HORIZON_HEIGHT;
+            moved->tso = 32768 - HORIZON_HEIGHT * step;
+        } else {
+            moved->sso = height;
+            moved->tso = 0;
+        }
+        projected[x].depth = MIN(forward, 0xFFFF);
+    }
+    return projected;
+}
+
+// True if two nearby columns show the same continuous wall face.
+static bool RendererSameFace(const RendererColumn *a, const RendererColumn *b)
+{
+    const int dh = a->sso - b->sso;
+    const int dc = a->tc - b->tc;
+    return a->tn == b->tn && a->light == b->light && dh >= -2 && dh <= 2 &&
+           dc >= -32 && dc <= 32;
+}
+
+// Tighter than RendererSameFace() on the texture coordinate, which a moved
+// hit point only approximates.
+static bool RendererContinuesFace(const RendererColumn *column,
+                                  const RendererColumn *traced)
+{
+    const int dc = column->tc - traced->tc;
+    return RendererSameFace(column, traced) && dc >= -8 && dc <= 8;
+}
+
+// Blends the two traced neighbours of column x if they belong to the same
+// continuous wall face.
+static bool RendererInterpolateColumn(const Renderer *renderer,
+                                      uint16_t x,
+                                      RendererColumn *column)
+{
+    const RendererColumn *a = &renderer->columns[x - 1];
+    const RendererColumn *b = &renderer->columns[x + 1];
+    if (!RendererSameFace(a, b)) {
+        return false;
+    }
+    column->sso = (a->sso + b->sso) >> 1;
+    column->tn = a->tn;
+    column->light = a->light;
+    column->tc = (a->tc + b->tc) >> 1;
+    column->tso = ((uint32_t) a->tso + b->tso) >> 1;
+    column->tst = ((uint32_t) a->tst + b->tst) >> 1;
+    return true;
+}
+
+// Magnified walls: every texel covers one or more consecutive pixels, so
+// look up each texel once and fill its whole run.
+static uint32_t *RendererFillWallSpans(uint32_t *lb,
+                                       uint16_t width,
+                                       const uint32_t *texture,
+                                       int tx,
+                                       uint16_t to,
+                                       uint16_t ts,
+                                       int count)
+{
+    // 16.16 reciprocal of the step, estimates the run length from below
+    const uint32_t inverse = ts ? (1u << 16) / ts : 0;
+    uint32_t position = to;
+
+    while (count > 0) {
+        const uint32_t texel = position >> 10;
+        const uint32_t tv = texture[((texel & 0x3F) << 6) + tx];
+
+        // pixels until the texture offset reaches the next texel
+        int run = count;
+        if (ts) {
+            const uint32_t next = (texel + 1) << 10;
+            uint32_t n = ((next - position) * inverse) >> 16;
+            while (position + n * ts < next) {
+                n++;
+            }
+            if ((int) n < run) {
+                run = n;
             }
+            position += run * ts;
+        }
+        count -= run;
+
+        for (; run > 0; run--) {
             *lb = tv;
-            lb += SCREEN_WIDTH;
+            lb += width;
+        }
+    }
+    return lb;
+}
+
+// Scales the full-resolution wall slice of a column to the internal height
+// and returns its first row and height.
+static void RendererScaleColumn(const Renderer *renderer,
+                                const RendererColumn *column,
+                                int16_t *wallStart,
+                                uint16_t *wallHeight,
+                                uint16_t *textureStep)
+{
+    const uint16_t horizon = renderer->height >> 1;
+    uint16_t wh = (column->sso * renderer->rowScale) >> 8;
+    uint32_t ts = ((uint32_t) column->tst * renderer->rowStep) >> 8;
+    if (ts > 0xFFFF) {
+        ts = 0xFFFF;
+    }
+
+    int16_t ws = horizon - wh;
+    if (ws < 0) {
+        ws = 0;
+        wh = horizon;
+    }
+    *wallStart = ws;
+    *wallHeight = wh * 2;
+    *textureStep = ts;
+}
+
+static void RendererDrawColumn(const Renderer *renderer,
+                               const RendererColumn *column,
+                               uint32_t *lb)
+{
+    const uint16_t width = renderer->width;
+    const uint32_t *texture = RendererColumnTexture(renderer, column);
+    const int tx = (int) (column->tc >> 2);
+    int16_t ws;
+    uint16_t wh;
+    uint16_t ts;
+    RendererScaleColumn(renderer, column, &ws, &wh, &ts);
+    uint16_t to = column->tso;
+    int y = 0;
+
+    if (renderer->flats) {
+        // floor and ceiling are already cast, only draw the wall
+        y = ws;
+        lb += ws * width;
+    }
+    for (; y < ws; y++) {
+        *lb = renderer->background[y];
+        lb += width;
+    }
+
+    if (ts < 1 << 10) {
+        lb = RendererFillWallSpans(lb, width, texture, tx, to, ts, wh);
+    } else {
+        for (int i = 0; i < wh; i++) {
+            // paint texture pixel
+            int ty = (int) (to >> 10);
+            *lb = texture[(ty << 6) + tx];
+            to += ts;
+            lb += width;
+        }
+    }
+
+    if (renderer->flats) {
+        return;
+    }
+    for (y += wh; y < renderer->height; y++) {
+        *lb = renderer->background[y];
+        lb += width;
+    }
+}
+
+#ifdef RENDERER_PACKET
+// Draws RENDERER_PACKET adjacent columns row by row, one vector lane per
+// column, so every row of the packet is a single contiguous store.
+static void RendererDrawPacket(const Renderer *renderer,
+                               const RendererColumn *columns,
+                               uint32_t *fb)
+{
+    const uint16_t width = renderer->width;
+    int32_t start[RENDERER_PACKET] __attribute__((aligned(32)));
+    int32_t end[RENDERER_PACKET] __attribute__((aligned(32)));
+    int32_t offset[RENDERER_PACKET] __attribute__((aligned(32)));
+    int32_t step[RENDERER_PACKET] __attribute__((aligned(32)));
+    // texel index of column 0 in the shade ramps of every lane
+    int32_t base[RENDERER_PACKET] __attribute__((aligned(32)));
+    int top = renderer->height;
+    int bottom = 0;
+
+    for (int i = 0; i < RENDERER_PACKET; i++) {
+        int16_t ws;
+        uint16_t wh;
+        uint16_t ts;
+        RendererScaleColumn(renderer, &columns[i], &ws, &wh, &ts);
+        start[i] = ws;
+        end[i] = ws + wh;
+        offset[i] = columns[i].tso;
+        step[i] = ts;
+        base[i] = (RendererColumnTexture(renderer, &columns[i]) -
+                   renderer->wallShades) +
+                  (columns[i].tc >> 2);
+        top = MIN(top, start[i]);
+        bottom = MAX(bottom, end[i]);
+    }
+
+    int y = renderer->flats ? top : 0;
+    for (; y < top; y++) {
+        uint32_t *lb = fb + y * width;
+        for (int i = 0; i < RENDERER_PACKET; i++) {
+            lb[i] = renderer->background[y];
+        }
+    }
+
+#if defined(__AVX2__)
+    const __m256i vStart = _mm256_load_si256((const __m256i *) start);
+    const __m256i vEnd = _mm256_load_si256((const __m256i *) end);
+    const __m256i vStep = _mm256_load_si256((const __m256i *) step);
+    const __m256i vBase = _mm256_load_si256((const __m256i *) base);
+    const __m256i vOffsetMask = _mm256_set1_epi32(0xFFFF);
+    __m256i vOffset = _mm256_load_si256((const __m256i *) offset);
+
+    for (; y < bottom; y++) {
+        const __m256i vY = _mm256_set1_epi32(y);
+        const __m256i inWall = _mm256_andnot_si256(
+            _mm256_cmpgt_epi32(vStart, vY), _mm256_cmpgt_epi32(vEnd, vY));
+        const __m256i index = _mm256_add_epi32(
+            _mm256_slli_epi32(_mm256_srli_epi32(vOffset, 10), 6), vBase);
+        __m256i tv = _mm256_mask_i32gather_epi32(
+            _mm256_setzero_si256(), (const int *) renderer->wallShades, index,
+            inWall, 4);
+        const __m256i back =
+            renderer->flats
+                ? _mm256_loadu_si256((const __m256i *) (fb + y * width))
+                : _mm256_set1_epi32((int) renderer->background[y]);
+        tv = _mm256_blendv_epi8(back, tv, inWall);
+        _mm256_storeu_si256((__m256i *) (fb + y * width), tv);
+        vOffset = _mm256_and_si256(
+            _mm256_add_epi32(vOffset, _mm256_and_si256(vStep, inWall)),
+            vOffsetMask);
+    }
+#else
+    const __m128i vStart = _mm_load_si128((const __m128i *) start);
+    const __m128i vEnd = _mm_load_si128((const __m128i *) end);
+    const __m128i vStep = _mm_load_si128((const __m128i *) step);
+    const __m128i vBase = _mm_load_si128((const __m128i *) base);
+    const __m128i vOffsetMask = _mm_set1_epi32(0xFFFF);
+    __m128i vOffset = _mm_load_si128((const __m128i *) offset);
+    int32_t index[RENDERER_PACKET] __attribute__((aligned(16)));
+
+    for (; y < bottom; y++) {
+        const __m128i vY = _mm_set1_epi32(y);
+        const __m128i inWall = _mm_andnot_si128(_mm_cmpgt_epi32(vStart, vY),
+                                                _mm_cmpgt_epi32(vEnd, vY));
+        _mm_store_si128(
+            (__m128i *) index,
+            _mm_add_epi32(_mm_slli_epi32(_mm_srli_epi32(vOffset, 10), 6),
+                          vBase));
+        // no gather before AVX2; lanes outside the wall read a valid texel
+        // that the blend below throws away
+        const uint32_t *shades = renderer->wallShades;
+        __m128i tv = _mm_set_epi32((int) shades[index[3]],
+                                   (int) shades[index[2]],
+                                   (int) shades[index[1]],
+                                   (int) shades[index[0]]);
+        const __m128i back =
+            renderer->flats
+                ? _mm_loadu_si128((const __m128i *) (fb + y * width))
+                : _mm_set1_epi32((int) renderer->background[y]);
+        tv = _mm_or_si128(_mm_and_si128(inWall, tv),
+                          _mm_andnot_si128(inWall, back));
+        _mm_storeu_si128((__m128i *) (fb + y * width), tv);
+        vOffset = _mm_and_si128(
+            _mm_add_epi32(vOffset, _mm_and_si128(vStep, inWall)), vOffsetMask);
+    }
+#endif
+
+    if (renderer->flats) {
+        return;
+    }
+    for (; y < renderer->height; y++) {
+        uint32_t *lb = fb + y * width;
+        for (int i = 0; i < RENDERER_PACKET; i++) {
+            lb[i] = renderer->background[y];
         }
+    }
+}
+#endif
 
-        for (int y = 0; y < ws; y++) {
-            *lb = ADD_RGBA(
-                MULT_SCALAR_RGBA(96 + (HORIZON_HEIGHT - (ws - y)), 0xFF53769B),
-                MULT_SCALAR_RGBA(255 - (96 + (HORIZON_HEIGHT - (ws - y))),
-                                 0xFFFFFFFF));
-            lb += SCREEN_WIDTH;
+// Walks one screen row across the floor plane. Positions are in tiles with
+// 16 fractional bits, so bits 10-15 address the 64 texels of a tile.
+static void RendererCastRow(uint32_t *lb,
+                            int width,
+                            int32_t posX,
+                            int32_t posY,
+                            int32_t stepX,
+                            int32_t stepY,
+                            const uint32_t *texture)
+{
+    int x = 0;
+#if defined(__AVX2__)
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i mask = _mm256_set1_epi32(63);
+    __m256i vX = _mm256_add_epi32(_mm256_set1_epi32(posX),
+                                  _mm256_mullo_epi32(lanes,
+                                                     _mm256_set1_epi32(stepX)));
+    __m256i vY = _mm256_add_epi32(_mm256_set1_epi32(posY),
+                                  _mm256_mullo_epi32(lanes,
+                                                     _mm256_set1_epi32(stepY)));
+    const __m256i vStepX = _mm256_set1_epi32(stepX * 8);
+    const __m256i vStepY = _mm256_set1_epi32(stepY * 8);
+    for (; x + 8 <= width; x += 8) {
+        const __m256i u = _mm256_and_si256(_mm256_srai_epi32(vX, 10), mask);
+        const __m256i v = _mm256_and_si256(_mm256_srai_epi32(vY, 10), mask);
+        const __m256i index = _mm256_or_si256(_mm256_slli_epi32(v, 6), u);
+        _mm256_storeu_si256(
+            (__m256i *) (lb + x),
+            _mm256_i32gather_epi32((const int *) texture, index, 4));
+        vX = _mm256_add_epi32(vX, vStepX);
+        vY = _mm256_add_epi32(vY, vStepY);
+    }
+    posX += x * stepX;
+    posY += x * stepY;
+#elif defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(63);
+    __m128i vX = _mm_setr_epi32(posX, posX + stepX, posX + stepX * 2,
+                                posX + stepX * 3);
+    __m128i vY = _mm_setr_epi32(posY, posY + stepY, posY + stepY * 2,
+                                posY + stepY * 3);
+    const __m128i vStepX = _mm_set1_epi32(stepX * 4);
+    const __m128i vStepY = _mm_set1_epi32(stepY * 4);
+    int32_t index[4] __attribute__((aligned(16)));
+    for (; x + 4 <= width; x += 4) {
+        const __m128i u = _mm_and_si128(_mm_srai_epi32(vX, 10), mask);
+        const __m128i v = _mm_and_si128(_mm_srai_epi32(vY, 10), mask);
+        _mm_store_si128((__m128i *) index,
+                        _mm_or_si128(_mm_slli_epi32(v, 6), u));
+        _mm_storeu_si128(
+            (__m128i *) (lb + x),
+            _mm_setr_epi32((int) texture[index[0]], (int) texture[index[1]],
+                           (int) texture[index[2]], (int) texture[index[3]]));
+        vX = _mm_add_epi32(vX, vStepX);
+        vY = _mm_add_epi32(vY, vStepY);
+    }
+    posX += x * stepX;
+    posY += x * stepY;
+#endif
+    for (; x < width; x++) {
+        lb[x] = texture[(((posY >> 10) & 63) << 6) + ((posX >> 10) & 63)];
+        posX += stepX;
+        posY += stepY;
+    }
+}
+
+// Casts the floor and ceiling rows that are visible next to at least one
+// wall. Every row needs one start point and one step; the walk across the
+// row is additions only.
+static void RendererCastFlats(const Renderer *renderer,
+                              const Game *g,
+                              uint32_t *fb,
+                              uint16_t lowestWall)
+{
+    const uint16_t width = renderer->width;
+    const uint16_t horizon = renderer->height >> 1;
+    int16_t sine, cosine;
+    RendererDirection(g, &sine, &cosine);
+
+    for (int r = lowestWall; r < horizon; r++) {
+        // forward F = (sine, cosine), right R = (cosine, -sine); the row
+        // spans F - EDGE_TAN * R to F + EDGE_TAN * R at this distance
+        const int32_t d = renderer->flatDistance[r];
+        const int32_t forwardX = d * sine;
+        const int32_t forwardY = d * cosine;
+        const int32_t rightX = ((d * cosine) >> 8) * EDGE_TAN;
+        const int32_t rightY = -(((d * sine) >> 8) * EDGE_TAN);
+        const int32_t posX = ((int32_t) g->playerX << 8) + forwardX - rightX;
+        const int32_t posY = ((int32_t) g->playerY << 8) + forwardY - rightY;
+        const int32_t stepX =
+            ((int64_t) rightX * 2 * renderer->columnStep) / (SCREEN_WIDTH << 8);
+        const int32_t stepY =
+            ((int64_t) rightY * 2 * renderer->columnStep) / (SCREEN_WIDTH << 8);
+
+        const uint8_t level = renderer->lighting ? renderer->flatShade[r] : 0;
+
+        RendererCastRow(fb + (horizon + r) * width, width, posX, posY, stepX,
+                        stepY, g_flatShades[0][level]);
+        RendererCastRow(fb + (horizon - 1 - r) * width, width, posX, posY,
+                        stepX, stepY, g_flatShades[1][level]);
+    }
+}
+
+void RendererTraceFrame(Renderer *renderer, Game *g, uint32_t *fb)
+{
+    const uint16_t width = renderer->width;
+    // columns as drawn this frame; without scratch memory every column is
+    // traced and drawn in place
+    RendererColumn *visible =
+        FrameArenaAlloc(&g_frameArena, width * sizeof(RendererColumn));
+    const bool reuse =
+        visible && renderer->interleaved && renderer->historyValid;
+    if (!visible) {
+        visible = renderer->columns;
+    }
+    const uint8_t parity = reuse ? renderer->frame & 1 : 0;
+    const bool moved = g->playerX != renderer->history.playerX ||
+                       g->playerY != renderer->history.playerY;
+    int16_t rotation = g->playerA - renderer->history.playerA;
+    if (rotation >= 512) {
+        rotation -= 1024;
+    } else if (rotation < -512) {
+        rotation += 1024;
+    }
+    int source = 0;
+    uint8_t lowestWall = HORIZON_HEIGHT;
+    const RendererProjection *projected =
+        reuse && moved ? RendererReprojectMotion(renderer, g, parity) : NULL;
+
+    renderer->rc->Start(renderer->rc, g->playerX, g->playerY, g->playerA);
+
+    // trace the columns owned by this frame, or all of them
+    for (int x = reuse ? parity : 0; x < width; x += reuse ? 2 : 1) {
+        RendererTraceColumn(renderer, x, &renderer->columns[x]);
+    }
+
+    for (int x = 0; x < width; x++) {
+        const RendererColumn *column = &renderer->columns[x];
+        RendererColumn *drawn = &visible[x];
+
+        if (reuse && (x & 1) != parity) {
+            const bool inner = x > 0 && x < width - 1;
+            if (moved && inner &&
+                RendererInterpolateColumn(renderer, x, drawn)) {
+                // a moving player's continuous faces blend exactly from the
+                // traced neighbours, closer than a reprojection gets
+                lowestWall = MIN(lowestWall, drawn->sso);
+                continue;
+            }
+
+            // a standing player sees exactly last frame's column; a turning
+            // one sees another column of last frame if its ray lines up; a
+            // moving one sees last frame's hit points from elsewhere
+            const RendererColumn *reprojected = NULL;
+            if (!moved) {
+                reprojected = rotation == 0 ? column
+                                            : RendererReprojectColumn(
+                                                  renderer, x, rotation,
+                                                  parity, &source);
+            } else if (projected && projected[x].depth) {
+                reprojected = &projected[x].column;
+            }
+            if (reprojected && inner) {
+                // reject reprojections that disagree with the neighbours; a
+                // moved hit point also has to continue one of their faces
+                const RendererColumn *a = &renderer->columns[x - 1];
+                const RendererColumn *b = &renderer->columns[x + 1];
+                if (reprojected->sso + 1 < MIN(a->sso, b->sso) ||
+                    reprojected->sso > MAX(a->sso, b->sso) + 1 ||
+                    (moved && !RendererContinuesFace(reprojected, a) &&
+                     !RendererContinuesFace(reprojected, b))) {
+                    reprojected = NULL;
+                }
+            }
+
+            if (reprojected) {
+                *drawn = *reprojected;
+            } else if (!inner || moved ||
+                       !RendererInterpolateColumn(renderer, x, drawn)) {
+                // wall edge or screen border: trace it after all, but keep
+                // last frame's ray in the history for later reprojections
+                RendererTraceColumn(renderer, x, drawn);
+            }
+        } else {
+            *drawn = *column;
         }
+        lowestWall = MIN(lowestWall, drawn->sso);
+    }
+
+    if (renderer->flats) {
+        RendererCastFlats(renderer, g, fb,
+                          (lowestWall * renderer->rowScale) >> 8);
+    }
+
+    int x = 0;
+#ifdef RENDERER_PACKET
+    for (; x + RENDERER_PACKET <= width; x += RENDERER_PACKET) {
+        RendererDrawPacket(renderer, &visible[x], fb + x);
     }
+#endif
+    for (; x < width; x++) {
+        RendererDrawColumn(renderer, &visible[x], fb + x);
+    }
+
+    renderer->history = *g;
+    renderer->historyValid = true;
+    renderer->frame++;
 }
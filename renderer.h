@@ -1,14 +1,80 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "game.h"
 #include "raycaster.h"
 
+// Trace() results for one screen column
+typedef struct {
+    uint8_t sso;
+    uint8_t tn;
+    uint8_t tc;
+    uint16_t tso;
+    uint16_t tst;
+    // light map level of the wall tile that was hit
+    uint8_t light;
+} RendererColumn;
+
 typedef struct {
     RayCaster *rc;
+    // internal resolution, at most SCREEN_WIDTH x SCREEN_HEIGHT
+    uint16_t width;
+    uint16_t height;
+    // 8.8 fixed-point factors between internal and full resolution
+    uint16_t columnStep;
+    uint16_t rowStep;
+    uint16_t rowScale;
+    // ceiling and floor colour of every row, which only depends on the row
+    uint32_t background[SCREEN_HEIGHT];
+
+    // textured floor and ceiling instead of the background gradient
+    bool flats;
+    // floor distance of every row below the horizon, 8.8 tiles
+    uint16_t flatDistance[SCREEN_HEIGHT / 2];
+
+    // wall textures by tile type, laid out as
+    // uint32_t[wallTypes][2][SHADE_LEVELS][4096]
+    const uint32_t *wallShades;
+    uint16_t wallTypes;
+
+    // distance fog and light map shading
+    bool lighting;
+    // fog level of every floor and ceiling row pair
+    uint8_t flatShade[SCREEN_HEIGHT / 2];
+
+    // interleaved mode traces only every other column per frame and
+    // reconstructs the rest from the previous frame or the neighbours
+    bool interleaved;
+    bool historyValid;
+    uint8_t frame;
+    Game history;
+    // latest traced result of every column
+    RendererColumn columns[SCREEN_WIDTH];
 } Renderer;
 
 Renderer RendererConstruct(RayCaster *rc);
 
 void RendererDestruct(Renderer *renderer);
 
+// Switches to another caster of the same map, eg. to compare the float and
+// fixed-point ones on the same view.
+void RendererSetRayCaster(Renderer *renderer, RayCaster *rc);
+
+void RendererSetResolution(Renderer *renderer, uint16_t width, uint16_t height);
+
+void RendererSetFlats(Renderer *renderer, bool flats);
+
+// Samples walls from externally provided shade ramps, eg. a mapped texture
+// atlas, which must outlive their use. NULL restores the built-in ones.
+void RendererSetTextures(Renderer *renderer,
+                         const uint32_t *wallShades,
+                         uint16_t wallTypes);
+
+void RendererSetLighting(Renderer *renderer, bool lighting);
+
+void RendererSetInterleaved(Renderer *renderer, bool interleaved);
+
+// Renders into a tightly packed renderer->width x renderer->height buffer.
+// Scratch memory comes from g_frameArena.
 void RendererTraceFrame(Renderer *renderer, Game *g, uint32_t *frameBuffer);
@@ -0,0 +1,57 @@
+#include "resolution.h"
+
+#include "raycaster.h"
+
+// frames to wait after a change before the next decision
+#define RESOLUTION_COOLDOWN 16
+
+static void ResolutionControllerApply(ResolutionController *controller)
+{
+    controller->width = (SCREEN_WIDTH * (8 - controller->level)) >> 3;
+    controller->height = (SCREEN_HEIGHT * (8 - controller->level)) >> 3;
+    controller->cooldown = RESOLUTION_COOLDOWN;
+}
+
+ResolutionController ResolutionControllerConstruct(uint32_t budget)
+{
+    ResolutionController controller;
+    controller.budget = budget;
+    controller.average = budget;
+    controller.level = 0;
+    ResolutionControllerApply(&controller);
+    return controller;
+}
+
+bool ResolutionControllerUpdate(ResolutionController *controller,
+                                uint32_t frameTime)
+{
+    // exponential moving average with a weight of 1/8
+    controller->average =
+        controller->average - (controller->average >> 3) + (frameTime >> 3);
+
+    if (controller->cooldown > 0) {
+        controller->cooldown--;
+        return false;
+    }
+
+    // trace cost follows the pixel count, so predict the frame time of the
+    // next level up from the ratio of the areas and keep 1/8 in reserve
+    const uint32_t area = (8 - controller->level) * (8 - controller->level);
+    const uint32_t largerArea =
+        (9 - controller->level) * (9 - controller->level);
+    const uint32_t reserve = controller->budget - (controller->budget >> 3);
+
+    if (controller->average > controller->budget &&
+        controller->level < RESOLUTION_LEVELS - 1) {
+        controller->level++;
+    } else if (controller->level > 0 &&
+               (uint64_t) controller->average * largerArea <
+                   (uint64_t) reserve * area) {
+        controller->level--;
+    } else {
+        return false;
+    }
+
+    ResolutionControllerApply(controller);
+    return true;
+}
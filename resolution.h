@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RESOLUTION_LEVELS 5
+
+// Picks the internal render resolution from measured frame times. Level 0 is
+// full resolution; every level below removes another eighth of each axis.
+typedef struct {
+    uint32_t budget;
+    uint32_t average;
+    uint8_t level;
+    uint8_t cooldown;
+    uint16_t width;
+    uint16_t height;
+} ResolutionController;
+
+ResolutionController ResolutionControllerConstruct(uint32_t budget);
+
+// Feeds the time spent rendering the last frame, in the same unit as the
+// budget. Returns true when width/height changed.
+bool ResolutionControllerUpdate(ResolutionController *controller,
+                                uint32_t frameTime);
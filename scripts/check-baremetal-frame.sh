@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+#
+# Boots the bare-metal image under QEMU, presses 'c' on its UART to capture a
+# frame and checks that the host fixed-point renderer draws the same frame
+# for the same view. Run from the top-level directory.
+
+BOOT_SECONDS=${BOOT_SECONDS:-8}
+SEND_SECONDS=${SEND_SECONDS:-20}
+
+make raycaster_baremetal.elf fbcapture default.map || exit 1
+
+LOG=$(mktemp) || exit 1
+trap 'rm -f "$LOG"' EXIT
+
+# the UART is stdio: wait for the first frames, ask for a capture and keep
+# the input open until the frame has been sent
+(sleep "$BOOT_SECONDS"; printf c; sleep "$SEND_SECONDS") |
+    timeout $((BOOT_SECONDS + SEND_SECONDS + 5)) \
+        qemu-system-arm -M raspi0 -kernel raycaster_baremetal.elf \
+        -serial stdio -display none >"$LOG"
+
+./fbcapture -m default.map -o baremetal.ppm -r reference.ppm "$LOG"
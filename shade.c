@@ -0,0 +1,44 @@
+#include "shade.h"
+
+#include "pixel.h"
+
+void ShadeTint(uint32_t *out, const uint32_t *texture, uint32_t tint)
+{
+    const uint32_t r = ((tint >> 0) & 0xFF) + 1;
+    const uint32_t g = ((tint >> 8) & 0xFF) + 1;
+    const uint32_t b = ((tint >> 16) & 0xFF) + 1;
+    for (int i = 0; i < 4096; i++) {
+        const uint32_t tv = texture[i];
+        out[i] = (tv & 0xFF000000) | (((((tv >> 16) & 0xFF) * b) >> 8) << 16) |
+                 (((((tv >> 8) & 0xFF) * g) >> 8) << 8) |
+                 ((((tv >> 0) & 0xFF) * r) >> 8);
+    }
+}
+
+uint8_t ShadeLevel(uint16_t distance)
+{
+    if (distance <= SHADE_FOG_START) {
+        return 0;
+    }
+    const uint32_t level = ((uint32_t) (distance - SHADE_FOG_START) *
+                            SHADE_LEVELS) /
+                           (SHADE_FOG_END - SHADE_FOG_START);
+    return level >= SHADE_LEVELS ? SHADE_LEVELS - 1 : level;
+}
+
+void ShadeBuildRamp(uint32_t (*ramp)[4096],
+                    const uint32_t *texture,
+                    bool darken)
+{
+    for (int i = 0; i < 4096; i++) {
+        uint32_t tv = texture[i];
+        if (darken && tv > 0) {
+            tv = PixelDarken(tv);
+        }
+        ramp[0][i] = tv;
+        for (int level = 1; level < SHADE_LEVELS; level++) {
+            const uint32_t scalar = 256 - ((level << 8) / SHADE_LEVELS);
+            ramp[level][i] = PixelScaleRgb(scalar, tv);
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SHADE_LEVELS 8
+
+// distances in 8.8 tiles over which surfaces fade into darkness
+#define SHADE_FOG_START (3 << 8)
+#define SHADE_FOG_END (16 << 8)
+
+// Multiplies the colour channels of a 64x64 texture by those of an ABGR
+// tint, 0xFF leaving a channel as is.
+void ShadeTint(uint32_t *out, const uint32_t *texture, uint32_t tint);
+
+// Shade level of a surface at the given distance, 0 being unshaded.
+uint8_t ShadeLevel(uint16_t distance);
+
+// Fills ramp[0..SHADE_LEVELS) with copies of a 64x64 texture, each one level
+// darker than the previous. With darken set, every copy also gets the
+// halved colours of the shadowed wall side. ramp[0] may alias the texture.
+void ShadeBuildRamp(uint32_t (*ramp)[4096],
+                    const uint32_t *texture,
+                    bool darken);
@@ -0,0 +1,175 @@
+#include "text.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __SSE2__
+// per row byte: an all-ones lane for every lit pixel
+static uint32_t g_rowMasks[256][GLYPH_WIDTH] __attribute__((aligned(16)));
+#else
+// per row byte: up to four runs of lit pixels, packed as (start << 4) | length
+static uint8_t g_rowSpans[256][4];
+static uint8_t g_rowSpanCount[256];
+#endif
+
+static bool g_rowsExpanded = false;
+
+static void TextExpandRows(void)
+{
+    for (int bits = 0; bits < 256; bits++) {
+#ifdef __SSE2__
+        for (int i = 0; i < GLYPH_WIDTH; i++) {
+            g_rowMasks[bits][i] = (bits & (1 << i)) ? 0xFFFFFFFF : 0;
+        }
+#else
+        uint8_t count = 0;
+        for (int i = 0; i < GLYPH_WIDTH;) {
+            if (!(bits & (1 << i))) {
+                i++;
+                continue;
+            }
+            const int start = i;
+            while (i < GLYPH_WIDTH && (bits & (1 << i))) {
+                i++;
+            }
+            g_rowSpans[bits][count++] = (uint8_t) ((start << 4) | (i - start));
+        }
+        g_rowSpanCount[bits] = count;
+#endif
+    }
+    g_rowsExpanded = true;
+}
+
+TextRenderer TextRendererConstruct(const uint8_t (*font)[GLYPH_HEIGHT])
+{
+    TextRenderer text;
+    text.font = font;
+
+    if (!g_rowsExpanded) {
+        TextExpandRows();
+    }
+
+    for (int c = 0; c < 128; c++) {
+        uint8_t top = GLYPH_HEIGHT;
+        uint8_t bottom = 0;
+        for (int j = 0; j < GLYPH_HEIGHT; j++) {
+            if (font[c][j]) {
+                if (top == GLYPH_HEIGHT) {
+                    top = j;
+                }
+                bottom = j + 1;
+            }
+        }
+        text.top[c] = top;
+        text.bottom[c] = bottom;
+    }
+    return text;
+}
+
+static inline void TextBlitRow(uint32_t *lb, uint8_t bits, uint32_t color)
+{
+#ifdef __SSE2__
+    const __m128i c = _mm_set1_epi32((int) color);
+    const __m128i m0 = _mm_load_si128((const __m128i *) g_rowMasks[bits]);
+    const __m128i m1 = _mm_load_si128((const __m128i *) g_rowMasks[bits] + 1);
+    __m128i d0 = _mm_loadu_si128((const __m128i *) lb);
+    __m128i d1 = _mm_loadu_si128((const __m128i *) lb + 1);
+    d0 = _mm_or_si128(_mm_and_si128(m0, c), _mm_andnot_si128(m0, d0));
+    d1 = _mm_or_si128(_mm_and_si128(m1, c), _mm_andnot_si128(m1, d1));
+    _mm_storeu_si128((__m128i *) lb, d0);
+    _mm_storeu_si128((__m128i *) lb + 1, d1);
+#else
+    for (int n = 0; n < g_rowSpanCount[bits]; n++) {
+        const uint8_t span = g_rowSpans[bits][n];
+        uint32_t *p = lb + (span >> 4);
+        for (int i = span & 0xF; i > 0; i--) {
+            *p++ = color;
+        }
+    }
+#endif
+}
+
+static void TextRendererPutLine(const TextRenderer *text,
+                                uint32_t *fb,
+                                int width,
+                                int height,
+                                const char *line,
+                                int length,
+                                int x,
+                                int y,
+                                uint32_t color)
+{
+    // clip whole glyphs against the left and right edges
+    int first = 0;
+    if (x < 0) {
+        first = (-x + GLYPH_WIDTH - 1) / GLYPH_WIDTH;
+    }
+    if (x + length * GLYPH_WIDTH > width) {
+        length = (width - x) / GLYPH_WIDTH;
+    }
+    if (first >= length) {
+        return;
+    }
+
+    // only visit rows that at least one glyph on this line uses
+    int top = GLYPH_HEIGHT;
+    int bottom = 0;
+    for (int k = first; k < length; k++) {
+        const uint8_t c = line[k] & 0x7F;
+        if (text->top[c] < top) {
+            top = text->top[c];
+        }
+        if (text->bottom[c] > bottom) {
+            bottom = text->bottom[c];
+        }
+    }
+    if (y + top < 0) {
+        top = -y;
+    }
+    if (y + bottom > height) {
+        bottom = height - y;
+    }
+
+    for (int j = top; j < bottom; j++) {
+        uint32_t *lb = fb + (y + j) * width + x;
+        for (int k = first; k < length; k++) {
+            const uint8_t bits = text->font[line[k] & 0x7F][j];
+            if (bits) {
+                TextBlitRow(lb + k * GLYPH_WIDTH, bits, color);
+            }
+        }
+    }
+}
+
+void TextRendererPuts(const TextRenderer *text,
+                      uint32_t *fb,
+                      int width,
+                      int height,
+                      const char *str,
+                      int x,
+                      int y,
+                      uint32_t color)
+{
+    for (;;) {
+        int length = 0;
+        while (str[length] != '\0' && str[length] != '\n') {
+            length++;
+        }
+        if (y >= height) {
+            return;
+        }
+        if (length > 0 && y + GLYPH_HEIGHT > 0) {
+            TextRendererPutLine(text, fb, width, height, str, length, x, y,
+                                color);
+        }
+        if (str[length] == '\0') {
+            return;
+        }
+        str += length + 1;
+        y += GLYPH_HEIGHT;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+#define GLYPH_WIDTH 8
+#define GLYPH_HEIGHT 16
+
+typedef struct {
+    const uint8_t (*font)[GLYPH_HEIGHT];
+    // first and one-past-last non-empty row of every glyph
+    uint8_t top[128];
+    uint8_t bottom[128];
+} TextRenderer;
+
+TextRenderer TextRendererConstruct(const uint8_t (*font)[GLYPH_HEIGHT]);
+
+// Draws a string in a single row-major pass. '\n' starts a new line; glyphs
+// that do not fit inside the buffer are clipped.
+void TextRendererPuts(const TextRenderer *text,
+                      uint32_t *fb,
+                      int width,
+                      int height,
+                      const char *str,
+                      int x,
+                      int y,
+                      uint32_t color);
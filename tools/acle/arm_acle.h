@@ -0,0 +1,34 @@
+// Portable stand-ins for the ARMv6 SIMD intrinsics pixel.h uses, so
+// tools/pixelcheck can run its __ARM_FEATURE_SIMD32 path on the host. Only
+// found through -I tools/acle; nothing else includes it.
+#pragma once
+
+#include <stdint.h>
+
+// zero-extends bytes 0 and 2 into the two halfwords
+static inline uint32_t __uxtb16(uint32_t x)
+{
+    return x & 0x00FF00FF;
+}
+
+// byte-wise add, saturating at 255
+static inline uint32_t __uqadd8(uint32_t a, uint32_t b)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF);
+        result |= (sum > 0xFF ? 0xFF : sum) << shift;
+    }
+    return result;
+}
+
+// byte-wise halving add
+static inline uint32_t __uhadd8(uint32_t a, uint32_t b)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF);
+        result |= (sum >> 1) << shift;
+    }
+    return result;
+}
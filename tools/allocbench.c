@@ -0,0 +1,352 @@
+// Replays a random allocation trace against the bare-metal allocator (mem.c
+// built with -DMEM_HOST) and the host libc, checking every result of the
+// former along the way.
+//
+//   allocbench [-s seed] [-n ops] [-l live slots] [-c]
+//
+// Reports throughput, worst-case and 99th percentile latency per call and
+// how fragmented the free memory gets. -c skips the libc run. Exits non-zero
+// when a check fails.
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mem.h"
+
+#define MAX_SLOTS 65536
+// latency histogram buckets, one per power of two nanoseconds
+#define LATENCY_BUCKETS 32
+// fragmentation is sampled every this many operations
+#define SAMPLE_INTERVAL 1024
+
+typedef enum { OP_ALLOC, OP_ALIGNED, OP_REALLOC, OP_FREE } OpKind;
+
+typedef struct {
+    uint8_t kind;
+    uint32_t slot;
+    uint32_t size;
+    uint32_t alignment;
+} Op;
+
+typedef struct {
+    const char *name;
+    void *(*alloc)(size_t size);
+    void *(*alignedAlloc)(size_t alignment, size_t size);
+    void *(*realloc)(void *ptr, size_t size);
+    void (*free)(void *ptr);
+    // the allocator under test gets its results and heap checked
+    bool checked;
+} Allocator;
+
+typedef struct {
+    void *ptr;
+    uint32_t size;
+    uint8_t fill;
+} Slot;
+
+typedef struct {
+    uint64_t nanoseconds;
+    uint64_t worst;
+    uint64_t histogram[LATENCY_BUCKETS];
+    uint32_t failed;
+    uint32_t errors;
+    double fragmentation;
+    double worstFragmentation;
+    uint32_t samples;
+} Result;
+
+static Slot g_slots[MAX_SLOTS];
+
+static uint32_t Random(uint32_t *state)
+{
+    // xorshift32
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// Mostly small objects, some medium buffers and the odd large one, roughly
+// what the renderer and the mailbox ask for.
+static uint32_t RandomSize(uint32_t *state)
+{
+    const uint32_t r = Random(state) % 100;
+    if (r < 80) {
+        return 1 + Random(state) % 256;
+    }
+    if (r < 98) {
+        return 257 + Random(state) % 8192;
+    }
+    return 8449 + Random(state) % (256 * 1024);
+}
+
+static Op *BuildTrace(uint32_t seed, uint32_t count, uint32_t slots)
+{
+    Op *ops = malloc(count * sizeof(Op));
+    bool *live = calloc(slots, sizeof(bool));
+    if (ops == NULL || live == NULL) {
+        free(ops);
+        free(live);
+        return NULL;
+    }
+    uint32_t state = seed ? seed : 1;
+    for (uint32_t i = 0; i < count; i++) {
+        Op *op = &ops[i];
+        op->slot = Random(&state) % slots;
+        op->size = RandomSize(&state);
+        op->alignment = 32u << (Random(&state) % 4);
+        const uint32_t r = Random(&state) % 10;
+        if (!live[op->slot]) {
+            op->kind = r < 7 ? OP_ALLOC : OP_ALIGNED;
+            live[op->slot] = true;
+        } else {
+            op->kind = r < 7 ? OP_FREE : OP_REALLOC;
+            live[op->slot] = op->kind == OP_REALLOC;
+        }
+    }
+    free(live);
+    return ops;
+}
+
+static uint64_t Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void Record(Result *result, uint64_t start)
+{
+    const uint64_t elapsed = Now() - start;
+    result->nanoseconds += elapsed;
+    if (elapsed > result->worst) {
+        result->worst = elapsed;
+    }
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (elapsed >> bucket) > 1) {
+        bucket++;
+    }
+    result->histogram[bucket]++;
+}
+
+// Checks a sample of the fill pattern, enough to catch overlapping blocks.
+static bool SlotIntact(const Slot *slot, uint32_t size)
+{
+    const uint8_t *bytes = slot->ptr;
+    const uint32_t step = size / 16 + 1;
+    for (uint32_t i = 0; i < size; i += step) {
+        if (bytes[i] != slot->fill) {
+            return false;
+        }
+    }
+    return size == 0 || bytes[size - 1] == slot->fill;
+}
+
+static void Fail(Result *result, const char *what, uint32_t op)
+{
+    if (result->errors++ < 8) {
+        fprintf(stderr, "  op %u: %s\n", op, what);
+    }
+}
+
+static void SampleFragmentation(Result *result)
+{
+    MemStats stats;
+    mem_stats(&stats);
+    if (stats.freeBytes == 0) {
+        return;
+    }
+    const double fragmentation =
+        1.0 - (double) stats.largestFree / stats.freeBytes;
+    result->fragmentation += fragmentation;
+    if (fragmentation > result->worstFragmentation) {
+        result->worstFragmentation = fragmentation;
+    }
+    result->samples++;
+}
+
+static void Replay(const Allocator *allocator,
+                   const Op *ops,
+                   uint32_t count,
+                   Result *result)
+{
+    memset(result, 0, sizeof(*result));
+    memset(g_slots, 0, sizeof(g_slots));
+    for (uint32_t i = 0; i < count; i++) {
+        const Op *op = &ops[i];
+        Slot *slot = &g_slots[op->slot];
+        void *ptr = NULL;
+        uint64_t start;
+
+        if (allocator->checked && slot->ptr != NULL &&
+            !SlotIntact(slot, slot->size)) {
+            Fail(result, "block contents overwritten", i);
+        }
+        switch (op->kind) {
+        case OP_ALLOC:
+        case OP_ALIGNED:
+            start = Now();
+            ptr = op->kind == OP_ALLOC
+                      ? allocator->alloc(op->size)
+                      : allocator->alignedAlloc(op->alignment, op->size);
+            Record(result, start);
+            if (ptr == NULL) {
+                result->failed++;
+                continue;
+            }
+            if (allocator->checked &&
+                (uintptr_t) ptr %
+                        (op->kind == OP_ALLOC ? 16 : op->alignment) !=
+                    0) {
+                Fail(result, "misaligned block", i);
+            }
+            slot->ptr = ptr;
+            slot->size = op->size;
+            slot->fill = (uint8_t) (i * 131 + 7);
+            memset(ptr, slot->fill, op->size);
+            break;
+        case OP_REALLOC:
+            if (slot->ptr == NULL) {
+                continue;
+            }
+            start = Now();
+            ptr = allocator->realloc(slot->ptr, op->size);
+            Record(result, start);
+            if (ptr == NULL) {
+                result->failed++;
+                continue;
+            }
+            slot->ptr = ptr;
+            if (allocator->checked &&
+                !SlotIntact(slot, slot->size < op->size ? slot->size
+                                                        : op->size)) {
+                Fail(result, "realloc lost contents", i);
+            }
+            slot->size = op->size;
+            memset(ptr, slot->fill, op->size);
+            break;
+        case OP_FREE:
+            if (slot->ptr == NULL) {
+                continue;
+            }
+            start = Now();
+            allocator->free(slot->ptr);
+            Record(result, start);
+            slot->ptr = NULL;
+            break;
+        }
+        if (allocator->checked && i % SAMPLE_INTERVAL == 0) {
+            SampleFragmentation(result);
+        }
+    }
+
+    for (uint32_t i = 0; i < MAX_SLOTS; i++) {
+        if (g_slots[i].ptr != NULL) {
+            allocator->free(g_slots[i].ptr);
+        }
+    }
+    if (allocator->checked) {
+        // everything freed has to coalesce back into the single pool block
+        MemStats stats;
+        mem_stats(&stats);
+        if (stats.freeBlocks != 1) {
+            Fail(result, "free blocks left uncoalesced", count);
+        }
+    }
+}
+
+static uint64_t Percentile(const Result *result, double fraction)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        total += result->histogram[i];
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += result->histogram[i];
+        if (seen >= total * fraction) {
+            return 2ull << i;
+        }
+    }
+    return 0;
+}
+
+static void Report(const Allocator *allocator,
+                   const Result *result,
+                   uint32_t count)
+{
+    printf("%-6s %8.2f Mops/s  worst %7llu ns  p99 < %5llu ns  %u failed",
+           allocator->name,
+           result->nanoseconds ? count * 1000.0 / result->nanoseconds : 0.0,
+           (unsigned long long) result->worst,
+           (unsigned long long) Percentile(result, 0.99), result->failed);
+    if (result->samples) {
+        printf("  fragmentation avg %.1f%% worst %.1f%%",
+               100.0 * result->fragmentation / result->samples,
+               100.0 * result->worstFragmentation);
+    }
+    printf("\n");
+}
+
+static void *LibcAlignedAlloc(size_t alignment, size_t size)
+{
+    // C11 wants the size to be a multiple of the alignment
+    return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = 1, count = 1000000, slots = 4096;
+    bool libc = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-c")) {
+            libc = false;
+        } else if (i + 1 < argc && !strcmp(argv[i], "-s")) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-n")) {
+            count = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-l")) {
+            slots = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-s seed] [-n ops] [-l slots] [-c]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (slots == 0 || slots > MAX_SLOTS) {
+        fprintf(stderr, "slots must be 1 to %d\n", MAX_SLOTS);
+        return 1;
+    }
+
+    Op *ops = BuildTrace(seed, count, slots);
+    if (ops == NULL) {
+        fprintf(stderr, "Could not allocate the trace\n");
+        return 1;
+    }
+
+    const Allocator allocators[] = {
+        {"tlsf", mem_host_malloc, mem_host_aligned_alloc, mem_host_realloc,
+         mem_host_free, true},
+        {"libc", malloc, LibcAlignedAlloc, realloc, free, false},
+    };
+    printf("seed %u, %u ops over %u slots\n", seed, count, slots);
+    mem_init();
+    int errors = 0;
+    for (int i = 0; i < (libc ? 2 : 1); i++) {
+        Result result;
+        Replay(&allocators[i], ops, count, &result);
+        Report(&allocators[i], &result, count);
+        errors += result.errors;
+    }
+
+    free(ops);
+    if (errors) {
+        fprintf(stderr, "%d check(s) failed\n", errors);
+        return 1;
+    }
+    return 0;
+}
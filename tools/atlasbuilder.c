@@ -0,0 +1,77 @@
+// Converts textures into the atlas format the SDL build maps at startup.
+//
+//   atlasbuilder out.atlas [texture.ppm ...]
+//
+// Every texture is a binary 64x64 PPM and becomes the tile type of its
+// position on the command line. Without any, the built-in tile types are
+// written.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas.h"
+#include "raycaster_data.h"
+#include "shade.h"
+
+static bool ReadPPM(const char *path, uint32_t *texture)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    int width, height, maxval;
+    bool ok = fscanf(f, "P6 %d %d %d", &width, &height, &maxval) == 3 &&
+              width == 64 && height == 64 && maxval == 255 && fgetc(f) != EOF;
+    for (int i = 0; ok && i < 4096; i++) {
+        uint8_t p[3];
+        ok = fread(p, 1, 3, f) == 3;
+        texture[i] = 0xFF000000 | (p[2] << 16) | (p[1] << 8) | p[0];
+    }
+    fclose(f);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s out.atlas [texture.ppm ...]\n", argv[0]);
+        return 1;
+    }
+
+    const int textures = argc > 2 ? argc - 2 : TILE_TYPES;
+    uint32_t(*shades)[2][SHADE_LEVELS][4096] =
+        calloc(textures, sizeof(*shades));
+    if (shades == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int t = 0; t < textures; t++) {
+        uint32_t *texture = shades[t][0][0];
+        if (argc > 2) {
+            if (!ReadPPM(argv[t + 2], texture)) {
+                fprintf(stderr, "%s: not a 64x64 binary PPM\n", argv[t + 2]);
+                return 1;
+            }
+        } else {
+            ShadeTint(texture, g_texture32, g_tileTint[t]);
+        }
+        ShadeBuildRamp(shades[t][0], texture, false);
+        ShadeBuildRamp(shades[t][1], texture, true);
+    }
+
+    uint8_t page[ATLAS_TEXELS_OFFSET];
+    memset(page, 0, sizeof(page));
+    const AtlasHeader header = {ATLAS_MAGIC,  ATLAS_VERSION, textures, 64,
+                                SHADE_LEVELS, ATLAS_TEXELS_OFFSET};
+    memcpy(page, &header, sizeof(header));
+
+    FILE *f = fopen(argv[1], "wb");
+    if (f == NULL || fwrite(page, sizeof(page), 1, f) != 1 ||
+        fwrite(shades, sizeof(*shades), textures, f) != (size_t) textures ||
+        fclose(f) != 0) {
+        fprintf(stderr, "%s: write failed\n", argv[1]);
+        return 1;
+    }
+    free(shades);
+    return 0;
+}
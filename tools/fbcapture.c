@@ -0,0 +1,208 @@
+// Decodes a frame the bare-metal build sent over the UART ('c' key) and
+// checks it against the same view rendered here by the fixed-point caster.
+//
+//   fbcapture [-m map] [-o capture.ppm] [-r reference.ppm] uart.log
+//
+// The map has to be the one linked into the image (default.map); without
+// one the built-in map is used. The last complete frame in the log counts.
+// Exits 0 when both frames are identical.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "capture.h"
+#include "game.h"
+#include "map.h"
+#include "raycaster_fixed.h"
+#include "renderer.h"
+#include "world.h"
+
+typedef struct {
+    CaptureHeader header;
+    uint32_t *pixels;
+} Capture;
+
+static uint8_t *ReadAll(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = length > 0 ? malloc(length) : NULL;
+    if (data != NULL && fread(data, 1, length, file) != (size_t) length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = length;
+    return data;
+}
+
+// Decodes the frame at data, or returns false if it is truncated, does not
+// fit the renderer or fails its hash.
+static bool CaptureDecode(Capture *capture, const uint8_t *data, size_t size)
+{
+    if (size < sizeof(CaptureHeader)) {
+        return false;
+    }
+    CaptureHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, CAPTURE_MAGIC, 4) != 0 || header.width == 0 ||
+        header.width > SCREEN_WIDTH || header.height == 0 ||
+        header.height > SCREEN_HEIGHT) {
+        return false;
+    }
+
+    const uint32_t count = (uint32_t) header.width * header.height;
+    uint32_t *pixels = malloc(count * sizeof(uint32_t));
+    if (pixels == NULL) {
+        return false;
+    }
+    size_t pos = sizeof(header);
+    uint32_t decoded = 0;
+    while (decoded < count && pos + 5 <= size) {
+        const uint8_t run = data[pos];
+        uint32_t pixel;
+        memcpy(&pixel, data + pos + 1, sizeof(pixel));
+        pos += 5;
+        if (run == 0 || decoded + run > count) {
+            break;
+        }
+        for (uint8_t i = 0; i < run; i++) {
+            pixels[decoded++] = pixel;
+        }
+    }
+    if (decoded != count || capture_hash(pixels, count) != header.hash) {
+        free(pixels);
+        return false;
+    }
+    free(capture->pixels);
+    capture->header = header;
+    capture->pixels = pixels;
+    return true;
+}
+
+static bool WritePpm(const char *path,
+                     const uint32_t *pixels,
+                     uint16_t width,
+                     uint16_t height)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+    for (uint32_t i = 0; i < (uint32_t) width * height; i++) {
+        // ABGR8888
+        const uint8_t rgb[3] = {pixels[i], pixels[i] >> 8, pixels[i] >> 16};
+        fwrite(rgb, 1, 3, file);
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *mapPath = NULL, *outPath = NULL, *referencePath = NULL;
+    const char *logPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && !strcmp(argv[i], "-m")) {
+            mapPath = argv[++i];
+        } else if (i + 1 < argc && !strcmp(argv[i], "-o")) {
+            outPath = argv[++i];
+        } else if (i + 1 < argc && !strcmp(argv[i], "-r")) {
+            referencePath = argv[++i];
+        } else if (logPath == NULL) {
+            logPath = argv[i];
+        } else {
+            logPath = NULL;
+            break;
+        }
+    }
+    if (logPath == NULL) {
+        fprintf(stderr,
+                "usage: %s [-m map] [-o capture.ppm] [-r reference.ppm] "
+                "uart.log\n",
+                argv[0]);
+        return 1;
+    }
+
+    size_t size;
+    uint8_t *data = ReadAll(logPath, &size);
+    if (data == NULL) {
+        fprintf(stderr, "Could not read %s\n", logPath);
+        return 1;
+    }
+    Capture capture = {0};
+    for (size_t pos = 0; pos < size; pos++) {
+        CaptureDecode(&capture, data + pos, size - pos);
+    }
+    free(data);
+    if (capture.pixels == NULL) {
+        fprintf(stderr, "No complete frame in %s\n", logPath);
+        return 1;
+    }
+    const CaptureHeader *header = &capture.header;
+    if (outPath) {
+        WritePpm(outPath, capture.pixels, header->width, header->height);
+    }
+
+    // the bare-metal build prefers a world over a flat map, so does this
+    static Map flatMap;
+    static World world;
+    const Map *map = &flatMap;
+    const bool streaming = mapPath && WorldOpen(&world, mapPath);
+    if (streaming) {
+        map = &world.map;
+    } else if (!mapPath) {
+        flatMap = MapConstruct();
+    } else if (!MapOpen(&flatMap, mapPath)) {
+        fprintf(stderr, "Could not load map %s\n", mapPath);
+        return 1;
+    }
+
+    Game game = GameConstruct(map);
+    game.playerX = header->playerX;
+    game.playerY = header->playerY;
+    game.playerA = header->playerA;
+    if (streaming) {
+        WorldUpdate(&world, &game);
+    }
+    RayCaster *rayCaster = RayCasterFixedConstruct(map);
+    Renderer renderer = RendererConstruct(rayCaster);
+    RendererSetResolution(&renderer, header->width, header->height);
+    RendererSetFlats(&renderer, header->flags & CAPTURE_FLATS);
+    RendererSetLighting(&renderer, header->flags & CAPTURE_LIGHTING);
+    static uint32_t reference[SCREEN_WIDTH * SCREEN_HEIGHT];
+    RendererTraceFrame(&renderer, &game, reference);
+    FrameArenaReset(&g_frameArena);
+    if (referencePath) {
+        WritePpm(referencePath, reference, renderer.width, renderer.height);
+    }
+
+    uint32_t differing = 0;
+    const uint32_t count = (uint32_t) header->width * header->height;
+    for (uint32_t i = 0; i < count; i++) {
+        differing += capture.pixels[i] != reference[i];
+    }
+    printf("%ux%u frame at %u,%u angle %d: ", header->width, header->height,
+           header->playerX, header->playerY, header->playerA);
+    if (renderer.width != header->width ||
+        renderer.height != header->height) {
+        printf("renderer refused the resolution\n");
+        differing = count;
+    } else if (differing) {
+        printf("%u of %u pixels differ\n", differing, count);
+    } else {
+        printf("identical\n");
+    }
+
+    rayCaster->Destruct(rayCaster);
+    free(capture.pixels);
+    return differing ? 1 : 0;
+}
@@ -0,0 +1,276 @@
+// Writes a map file for the SDL build to map or the bare-metal build to
+// link in.
+//
+//   mapbuilder [-w] out.map [layout.txt]
+//
+// With -w the map is written as a chunked world for streaming. A layout has
+// one line per row of tiles: '.' or ' ' is empty, '#' a wall of tile type 0,
+// a hex digit a wall of that tile type and '@' a spawn point, at most
+// MAP_MAX_SIZE tiles a side. Without a layout the built-in map is written.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "map.h"
+#include "raycaster_data.h"
+#include "world.h"
+
+#define LAYOUT_LINE (MAP_MAX_SIZE + 2)
+#define LAYOUT_SPAWNS 64
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t walls[MAP_MAX_SIZE][MAP_MAX_SIZE];
+    uint8_t types[MAP_MAX_SIZE][MAP_MAX_SIZE];
+    uint8_t light[MAP_MAX_SIZE][MAP_MAX_SIZE];
+    MapSpawn spawns[LAYOUT_SPAWNS];
+    uint16_t spawnCount;
+} Layout;
+
+static void LayoutFromMap(Layout *layout, const Map *map)
+{
+    layout->width = map->width;
+    layout->height = map->height;
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            layout->walls[y][x] =
+                (map->walls[0][(x >> 3) + y * map->wallStride] >>
+                 (7 - (x & 7))) &
+                1;
+            layout->types[y][x] = MapTileType(map, x, y);
+            layout->light[y][x] = MapLight(map, x, y);
+        }
+    }
+    layout->spawnCount = MIN(map->spawnCount, LAYOUT_SPAWNS);
+    memcpy(layout->spawns, map->spawns,
+           layout->spawnCount * sizeof(MapSpawn));
+}
+
+static bool LayoutRead(Layout *layout, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return false;
+    }
+    char line[LAYOUT_LINE + 1];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        const int y = layout->height++;
+        const size_t length = strcspn(line, "\r\n");
+        // fgets() splits a longer line, which must not become another row
+        const bool complete = line[length] != '\0' || feof(f);
+        ok = complete && y < MAP_MAX_SIZE && length <= MAP_MAX_SIZE;
+        for (size_t x = 0; ok && x < length; x++) {
+            const char c = line[x];
+            if (c == '@') {
+                ok = layout->spawnCount < LAYOUT_SPAWNS;
+                if (ok) {
+                    MapSpawn spawn = {(x << 8) + 128, (y << 8) + 128, 0, 0};
+                    layout->spawns[layout->spawnCount++] = spawn;
+                }
+            } else if (c == '#') {
+                layout->walls[y][x] = 1;
+            } else if (c >= '0' && c <= '9') {
+                layout->walls[y][x] = 1;
+                layout->types[y][x] = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                layout->walls[y][x] = 1;
+                layout->types[y][x] = c - 'a' + 10;
+            } else {
+                ok = c == '.' || c == ' ';
+            }
+        }
+        if (length > layout->width) {
+            layout->width = length;
+        }
+    }
+    fclose(f);
+    return ok && layout->width >= 2 && layout->height >= 2 &&
+           layout->spawnCount > 0;
+}
+
+// distance of an already visited tile, everything outside the map is wall
+static int LayoutNear(const Layout *layout, const uint8_t *distance, int x,
+                      int y)
+{
+    if (x < 0 || y < 0 || x >= layout->width || y >= layout->height) {
+        return 0;
+    }
+    return distance[x + y * layout->width];
+}
+
+// Chebyshev distance of every tile to the nearest wall, the border counting
+// as wall, from one forward and one backward pass.
+static void LayoutDistance(const Layout *layout, uint8_t *distance)
+{
+    const int w = layout->width;
+    const int h = layout->height;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int d = 0;
+            if (!layout->walls[y][x] && x < w - 1 && y < h - 1) {
+                d = MIN(LayoutNear(layout, distance, x - 1, y),
+                        LayoutNear(layout, distance, x - 1, y - 1));
+                d = MIN(d, LayoutNear(layout, distance, x, y - 1));
+                d = MIN(d, LayoutNear(layout, distance, x + 1, y - 1));
+                d = MIN(d + 1, 255);
+            }
+            distance[x + y * w] = d;
+        }
+    }
+    for (int y = h - 1; y >= 0; y--) {
+        for (int x = w - 1; x >= 0; x--) {
+            int d = MIN(LayoutNear(layout, distance, x + 1, y),
+                        LayoutNear(layout, distance, x + 1, y + 1));
+            d = MIN(d, LayoutNear(layout, distance, x, y + 1));
+            d = MIN(d, LayoutNear(layout, distance, x - 1, y + 1));
+            distance[x + y * w] = MIN(distance[x + y * w], d + 1);
+        }
+    }
+}
+
+static bool LayoutWrite(const char *path, const uint8_t *image, size_t size)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL || fwrite(image, size, 1, f) != 1 || fclose(f) != 0) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return false;
+    }
+    return true;
+}
+
+static bool LayoutWriteMap(const Layout *layout, const char *path)
+{
+    const uint16_t w = layout->width;
+    const uint16_t h = layout->height;
+    const uint16_t wallStride = (w + 7) >> 3;
+    const uint16_t typeStride = (w + 1) >> 1;
+    MapHeader header;
+    header.magic = MAP_MAGIC;
+    header.version = MAP_VERSION;
+    header.spawns = layout->spawnCount;
+    header.width = w;
+    header.height = h;
+    header.spawn = sizeof(MapHeader);
+    header.walls = header.spawn + layout->spawnCount * sizeof(MapSpawn);
+    header.types = header.walls + wallStride * h;
+    header.light = header.types + typeStride * h;
+    header.distance = header.light + w * h;
+    const size_t size = header.distance + w * h;
+
+    uint8_t *image = calloc(1, size);
+    if (image == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return false;
+    }
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.spawn, layout->spawns,
+           layout->spawnCount * sizeof(MapSpawn));
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            image[header.walls + (x >> 3) + y * wallStride] |=
+                layout->walls[y][x] << (7 - (x & 7));
+            image[header.types + (x >> 1) + y * typeStride] |=
+                (layout->types[y][x] & 0xF) << ((x & 1) << 2);
+            image[header.light + x + y * w] = layout->light[y][x];
+        }
+    }
+    LayoutDistance(layout, image + header.distance);
+
+    const bool ok = LayoutWrite(path, image, size);
+    free(image);
+    return ok;
+}
+
+// Splits the layout into 32x32 tile chunks, padding it with empty tiles.
+static bool LayoutWriteWorld(const Layout *layout, const char *path)
+{
+    const int chunksX = (layout->width + WORLD_CHUNK - 1) >> MAP_CHUNK_SHIFT;
+    const int chunksY = (layout->height + WORLD_CHUNK - 1) >> MAP_CHUNK_SHIFT;
+    WorldHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = WORLD_MAGIC;
+    header.version = WORLD_VERSION;
+    header.spawns = layout->spawnCount;
+    header.chunksX = chunksX;
+    header.chunksY = chunksY;
+    header.spawn = sizeof(WorldHeader);
+    header.chunks = header.spawn + layout->spawnCount * sizeof(MapSpawn);
+    size_t size = header.chunks + chunksX * chunksY * sizeof(uint32_t);
+    const size_t records = size;
+    size += (size_t) chunksX * chunksY * WORLD_CHUNK_BYTES;
+
+    uint8_t *image = calloc(1, size);
+    if (image == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return false;
+    }
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.spawn, layout->spawns,
+           layout->spawnCount * sizeof(MapSpawn));
+    uint32_t *chunks = (uint32_t *) (image + header.chunks);
+    size_t offset = records;
+    for (int cy = 0; cy < chunksY; cy++) {
+        for (int cx = 0; cx < chunksX; cx++) {
+            uint8_t *walls = image + offset;
+            uint8_t *types = walls + WORLD_CHUNK_WALLS;
+            uint8_t *light = types + WORLD_CHUNK_TYPES;
+            bool any = false;
+            for (int y = 0; y < WORLD_CHUNK; y++) {
+                for (int x = 0; x < WORLD_CHUNK; x++) {
+                    const int tx = (cx << MAP_CHUNK_SHIFT) + x;
+                    const int ty = (cy << MAP_CHUNK_SHIFT) + y;
+                    if (tx >= layout->width || ty >= layout->height) {
+                        continue;
+                    }
+                    any |= layout->walls[ty][tx];
+                    walls[(x >> 3) + y * (WORLD_CHUNK >> 3)] |=
+                        layout->walls[ty][tx] << (7 - (x & 7));
+                    types[(x >> 1) + y * (WORLD_CHUNK >> 1)] |=
+                        (layout->types[ty][tx] & 0xF) << ((x & 1) << 2);
+                    light[x + y * WORLD_CHUNK] = layout->light[ty][tx];
+                }
+            }
+            if (any) {
+                chunks[cx + cy * chunksX] = offset;
+                offset += WORLD_CHUNK_BYTES;
+            } else {
+                memset(walls, 0, WORLD_CHUNK_BYTES);
+            }
+        }
+    }
+
+    const bool ok = LayoutWrite(path, image, offset);
+    free(image);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    const bool world = argc > 1 && strcmp(argv[1], "-w") == 0;
+    if (world) {
+        argc--;
+        argv++;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s [-w] out.map [layout.txt]\n", argv[0]);
+        return 1;
+    }
+
+    static Layout layout;
+    if (argc > 2) {
+        if (!LayoutRead(&layout, argv[2])) {
+            fprintf(stderr,
+                    "%s: not a valid layout of at most %d by %d tiles\n",
+                    argv[2], MAP_MAX_SIZE, MAP_MAX_SIZE);
+            return 1;
+        }
+    } else {
+        const Map map = MapConstruct();
+        LayoutFromMap(&layout, &map);
+    }
+    const bool ok = world ? LayoutWriteWorld(&layout, argv[1])
+                          : LayoutWriteMap(&layout, argv[1]);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+// Checks that map and world images the fixed-point caster cannot address are
+// refused on load.
+//
+//   make check-map
+//
+// Builds images in memory at and past MAP_MAX_SIZE and with spawns on and
+// off the map. Exits non-zero when one is accepted or refused wrongly.
+// check-map also has mapbuilder refuse a layout one tile too wide.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "map.h"
+#include "world.h"
+
+static unsigned s_failures;
+
+static void Expect(bool accepted, bool expected, const char *what)
+{
+    if (accepted != expected) {
+        fprintf(stderr, "%s: %s\n", what,
+                accepted ? "accepted, should be refused"
+                         : "refused, should be accepted");
+        s_failures++;
+    }
+}
+
+// an empty map with a single spawn, in 8.8 tiles
+static uint8_t *MapImage(uint16_t width,
+                         uint16_t height,
+                         uint16_t spawnX,
+                         uint16_t spawnY,
+                         size_t *size)
+{
+    MapHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MAP_MAGIC;
+    header.version = MAP_VERSION;
+    header.spawns = 1;
+    header.width = width;
+    header.height = height;
+    header.spawn = sizeof(MapHeader);
+    header.walls = header.spawn + sizeof(MapSpawn);
+    header.types = header.walls + ((width + 7) >> 3) * height;
+    header.light = header.types + ((width + 1) >> 1) * height;
+    *size = header.light + width * height;
+
+    uint8_t *image = calloc(1, *size);
+    if (image == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    const MapSpawn spawn = {spawnX, spawnY, 0, 0};
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.spawn, &spawn, sizeof(spawn));
+    return image;
+}
+
+static void CheckMap(uint16_t width,
+                     uint16_t height,
+                     uint16_t spawnX,
+                     uint16_t spawnY,
+                     bool expected,
+                     const char *what)
+{
+    size_t size;
+    uint8_t *image = MapImage(width, height, spawnX, spawnY, &size);
+    static Map map;
+    Expect(MapLoad(&map, image, size), expected, what);
+    free(image);
+}
+
+// a world without any walls and a single spawn, in 8.8 tiles
+static uint8_t *WorldImage(uint8_t chunksX,
+                           uint8_t chunksY,
+                           uint16_t spawnX,
+                           uint16_t spawnY,
+                           size_t *size)
+{
+    WorldHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = WORLD_MAGIC;
+    header.version = WORLD_VERSION;
+    header.spawns = 1;
+    header.chunksX = chunksX;
+    header.chunksY = chunksY;
+    header.spawn = sizeof(WorldHeader);
+    header.chunks = header.spawn + sizeof(MapSpawn);
+    // every chunk offset 0, nothing to page in
+    *size = header.chunks + chunksX * chunksY * sizeof(uint32_t);
+
+    uint8_t *image = calloc(1, *size);
+    if (image == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    const MapSpawn spawn = {spawnX, spawnY, 0, 0};
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.spawn, &spawn, sizeof(spawn));
+    return image;
+}
+
+static void CheckWorld(uint8_t chunksX,
+                       uint8_t chunksY,
+                       uint16_t spawnX,
+                       uint16_t spawnY,
+                       bool expected,
+                       const char *what)
+{
+    size_t size;
+    uint8_t *image = WorldImage(chunksX, chunksY, spawnX, spawnY, &size);
+    static World world;
+    Expect(WorldLoad(&world, image, size), expected, what);
+    free(image);
+}
+
+int main(void)
+{
+    const uint16_t max = MAP_MAX_SIZE;
+    CheckMap(max, max, 0x100, 0x100, true, "largest map");
+    CheckMap(max + 1, max, 0x100, 0x100, false, "map one tile too wide");
+    CheckMap(max, max + 1, 0x100, 0x100, false, "map one tile too tall");
+    CheckMap(200, 200, 0x100, 0x100, false, "200x200 map");
+    CheckMap(32, 32, (32 << 8) - 1, (32 << 8) - 1, true, "spawn in the corner");
+    CheckMap(32, 32, 32 << 8, 0x100, false, "spawn right of the map");
+    CheckMap(32, 32, 0x100, 32 << 8, false, "spawn below the map");
+
+    const uint8_t chunks = MAP_MAX_SIZE / WORLD_CHUNK;
+    CheckWorld(chunks, chunks, 0x100, 0x100, true, "largest world");
+    CheckWorld(chunks + 1, chunks, 0x100, 0x100, false,
+               "world one chunk too wide");
+    CheckWorld(chunks, chunks + 1, 0x100, 0x100, false,
+               "world one chunk too tall");
+    CheckWorld(1, 1, WORLD_CHUNK << 8, 0x100, false,
+               "spawn right of the world");
+    CheckWorld(1, 1, 0x100, WORLD_CHUNK << 8, false,
+               "spawn below the world");
+
+    if (s_failures != 0) {
+        fprintf(stderr, "%u checks failed\n", s_failures);
+        return 1;
+    }
+    printf("maps past the caster's reach are refused\n");
+    return 0;
+}
@@ -0,0 +1,174 @@
+// Checks the packed pixel operations of pixel.h against the per-channel
+// macros they replaced.
+//
+//   pixelcheck [-n random inputs]
+//
+// Tries every combination of the edge channel values 0x00, 0x01, 0x7F,
+// 0x80, 0x81, 0xFE and 0xFF with scalars 0, 1, 127, 128, 255 and 256, then
+// random inputs. "make check-pixel" runs it once for the plain C path and
+// once built against tools/acle/arm_acle.h for the ARMv6 SIMD path. Exits
+// non-zero on a mismatch.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pixel.h"
+
+#define UMULT(x, y) (uint16_t)(((uint32_t) (x) * (uint32_t) (y)) >> 8)
+
+#define MULT_SCALAR_RGBA(scalar, rgba)                      \
+    (((uint8_t) UMULT(scalar, (rgba >> 24) & 0xFF) << 24) | \
+     ((uint8_t) UMULT(scalar, (rgba >> 16) & 0xFF) << 16) | \
+     ((uint8_t) UMULT(scalar, (rgba >> 8) & 0xFF) << 8) |   \
+     ((uint8_t) UMULT(scalar, (rgba >> 0) & 0xFF) << 0))
+
+#define ADD_RGBA(rgba1, rgba2)                                     \
+    ((((uint8_t) (rgba1 >> 24) + (uint8_t) (rgba2 >> 24)) << 24) | \
+     (((uint8_t) (rgba1 >> 16) + (uint8_t) (rgba2 >> 16)) << 16) | \
+     (((uint8_t) (rgba1 >> 8) + (uint8_t) (rgba2 >> 8)) << 8) |    \
+     (((uint8_t) (rgba1 >> 0) + (uint8_t) (rgba2 >> 0)) << 0))
+
+#define DARKEN_RGBA(rgba)                                                      \
+    (((uint8_t) (rgba >> 24) << 24) | (((uint8_t) (rgba >> 16) >> 1) << 16) | \
+     (((uint8_t) (rgba >> 8) >> 1) << 8) | (((uint8_t) (rgba >> 0) >> 1) << 0))
+
+#define SCALE_RGB(scalar, rgba)                            \
+    (((rgba) & 0xFF000000) |                               \
+     ((((((rgba) >> 16) & 0xFF) * (scalar)) >> 8) << 16) | \
+     ((((((rgba) >> 8) & 0xFF) * (scalar)) >> 8) << 8) |   \
+     (((((rgba) >> 0) & 0xFF) * (scalar)) >> 8))
+
+static const uint8_t g_edgeChannels[] = {0x00, 0x01, 0x7F, 0x80,
+                                         0x81, 0xFE, 0xFF};
+static const uint32_t g_edgeScalars[] = {0, 1, 127, 128, 255, 256};
+
+#define EDGE_CHANNELS (sizeof(g_edgeChannels) / sizeof(g_edgeChannels[0]))
+#define EDGE_SCALARS (sizeof(g_edgeScalars) / sizeof(g_edgeScalars[0]))
+#define EDGE_PIXELS \
+    (EDGE_CHANNELS * EDGE_CHANNELS * EDGE_CHANNELS * EDGE_CHANNELS)
+
+static unsigned long s_failures;
+
+static void Fail(const char *what, uint32_t a, uint32_t b, uint32_t got,
+                 uint32_t expected)
+{
+    if (s_failures++ < 20) {
+        fprintf(stderr, "%s(0x%08X, 0x%08X) = 0x%08X, expected 0x%08X\n",
+                what, a, b, got, expected);
+    }
+}
+
+// ADD_RGBA clamping every channel at 255, as PixelAdd() does
+static uint32_t SaturatingAdd(uint32_t rgba1, uint32_t rgba2)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = ((rgba1 >> shift) & 0xFF) + ((rgba2 >> shift) & 0xFF);
+        result |= (sum > 0xFF ? 0xFF : sum) << shift;
+    }
+    return result;
+}
+
+static void CheckPixel(uint32_t rgba)
+{
+    const uint32_t darken = DARKEN_RGBA(rgba);
+    if (PixelDarken(rgba) != darken) {
+        Fail("PixelDarken", rgba, 0, PixelDarken(rgba), darken);
+    }
+}
+
+static void CheckScale(uint32_t scalar, uint32_t rgba)
+{
+    const uint32_t scale = MULT_SCALAR_RGBA(scalar, rgba);
+    if (PixelScale(scalar, rgba) != scale) {
+        Fail("PixelScale", scalar, rgba, PixelScale(scalar, rgba), scale);
+    }
+    const uint32_t scaleRgb = SCALE_RGB(scalar, rgba);
+    if (PixelScaleRgb(scalar, rgba) != scaleRgb) {
+        Fail("PixelScaleRgb", scalar, rgba, PixelScaleRgb(scalar, rgba),
+             scaleRgb);
+    }
+}
+
+static void CheckAdd(uint32_t rgba1, uint32_t rgba2)
+{
+    const uint32_t sum = PixelAdd(rgba1, rgba2);
+    const uint32_t saturated = SaturatingAdd(rgba1, rgba2);
+    if (sum != saturated) {
+        Fail("PixelAdd", rgba1, rgba2, sum, saturated);
+    }
+    // the old macro is only right while nothing carries over
+    const uint32_t wrapped = ADD_RGBA(rgba1, rgba2);
+    if (saturated == wrapped && sum != wrapped) {
+        Fail("PixelAdd", rgba1, rgba2, sum, wrapped);
+    }
+}
+
+static uint32_t EdgePixel(size_t index)
+{
+    uint32_t rgba = 0;
+    for (int i = 0; i < 4; i++) {
+        rgba = (rgba << 8) | g_edgeChannels[index % EDGE_CHANNELS];
+        index /= EDGE_CHANNELS;
+    }
+    return rgba;
+}
+
+static uint32_t Random(uint32_t *state)
+{
+    // xorshift32
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+int main(int argc, char **argv)
+{
+    long randomInputs = 10000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n':
+            randomInputs = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n random inputs]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    for (size_t i = 0; i < EDGE_PIXELS; i++) {
+        const uint32_t rgba = EdgePixel(i);
+        CheckPixel(rgba);
+        for (size_t s = 0; s < EDGE_SCALARS; s++) {
+            CheckScale(g_edgeScalars[s], rgba);
+        }
+        for (size_t j = 0; j < EDGE_PIXELS; j++) {
+            CheckAdd(rgba, EdgePixel(j));
+        }
+    }
+
+    uint32_t state = 1;
+    for (long n = 0; n < randomInputs; n++) {
+        const uint32_t a = Random(&state);
+        const uint32_t b = Random(&state);
+        CheckPixel(a);
+        CheckScale(b % 257, a);
+        CheckAdd(a, b);
+        // sums that never carry, checked against ADD_RGBA itself
+        CheckAdd(a & 0x7F7F7F7F, b & 0x7F7F7F7F);
+    }
+
+    if (s_failures != 0) {
+        fprintf(stderr, "%lu mismatches\n", s_failures);
+        return 1;
+    }
+#if defined(__ARM_FEATURE_SIMD32)
+    printf("pixel.h (ARMv6 SIMD) matches the per-channel macros\n");
+#else
+    printf("pixel.h (C) matches the per-channel macros\n");
+#endif
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Decodes the per-frame profile records the bare-metal build streams over the
+// UART once 'p' is pressed, eg. from a capture of `make baremetal`.
+//
+//   profdecode [-f] [capture]
+//
+// Prints cycles, D-cache misses and branch mispredicts per stage, averaged
+// over all frames; -f also prints every frame. Text output between the
+// records is skipped. Reads stdin without a capture file.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+static const char *const g_stageNames[PROFILE_STAGES] = {
+    "world", "trace", "hud", "copy", "fill", "move",
+};
+
+typedef struct {
+    uint64_t cycles;
+    uint64_t dcacheMisses;
+    uint64_t branchMispredicts;
+    uint32_t maxCycles;
+} StageTotal;
+
+static uint8_t *ReadAll(FILE *file, size_t *size)
+{
+    size_t capacity = 1 << 16;
+    uint8_t *data = malloc(capacity);
+    *size = 0;
+    while (data != NULL) {
+        *size += fread(data + *size, 1, capacity - *size, file);
+        if (*size < capacity) {
+            break;
+        }
+        capacity *= 2;
+        uint8_t *grown = realloc(data, capacity);
+        if (grown == NULL) {
+            free(data);
+        }
+        data = grown;
+    }
+    return data;
+}
+
+static bool RecordValid(const uint8_t *bytes)
+{
+    ProfileRecord record;
+    memcpy(&record, bytes, sizeof(record));
+    if (memcmp(record.magic, PROFILE_MAGIC, 2) != 0 ||
+        record.stages != PROFILE_STAGES) {
+        return false;
+    }
+    uint8_t sum = 0;
+    for (size_t i = 0; i < sizeof(record); i++) {
+        sum += bytes[i];
+    }
+    // the checksum was computed with its own byte zeroed
+    sum -= record.checksum;
+    return sum == record.checksum;
+}
+
+static void PrintFrame(const ProfileRecord *record)
+{
+    printf("frame %u:", record->frame);
+    for (int i = 0; i < PROFILE_STAGES; i++) {
+        printf(" %s %u", g_stageNames[i], record->counters[i].cycles);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    bool frames = false;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-f")) {
+            frames = true;
+        } else if (path == NULL) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [-f] [capture]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *file = path ? fopen(path, "rb") : stdin;
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+    size_t size;
+    uint8_t *data = ReadAll(file, &size);
+    if (path) {
+        fclose(file);
+    }
+    if (data == NULL) {
+        fprintf(stderr, "Could not read the capture\n");
+        return 1;
+    }
+
+    StageTotal totals[PROFILE_STAGES] = {0};
+    uint32_t count = 0, dropped = 0, first = 0, last = 0;
+    for (size_t pos = 0; pos + sizeof(ProfileRecord) <= size;) {
+        if (!RecordValid(data + pos)) {
+            pos++;
+            continue;
+        }
+        ProfileRecord record;
+        memcpy(&record, data + pos, sizeof(record));
+        pos += sizeof(record);
+
+        if (count == 0) {
+            first = record.frame;
+        } else if (record.frame > last + 1) {
+            dropped += record.frame - last - 1;
+        }
+        last = record.frame;
+        count++;
+        for (int i = 0; i < PROFILE_STAGES; i++) {
+            const ProfileCounters *counters = &record.counters[i];
+            totals[i].cycles += counters->cycles;
+            totals[i].dcacheMisses += counters->dcacheMisses;
+            totals[i].branchMispredicts += counters->branchMispredicts;
+            if (counters->cycles > totals[i].maxCycles) {
+                totals[i].maxCycles = counters->cycles;
+            }
+        }
+        if (frames) {
+            PrintFrame(&record);
+        }
+    }
+    free(data);
+
+    if (count == 0) {
+        fprintf(stderr, "No profile records found\n");
+        return 1;
+    }
+
+    uint64_t frameCycles = 0;
+    for (int i = 0; i < PROFILE_STAGES; i++) {
+        frameCycles += totals[i].cycles;
+    }
+    printf("%u frames (%u to %u, %u missing)\n", count, first, last, dropped);
+    printf("%-8s %14s %7s %14s %12s %12s\n", "stage", "cycles/frame",
+           "share", "worst cycles", "D$ misses", "mispredicts");
+    for (int i = 0; i < PROFILE_STAGES; i++) {
+        const StageTotal *total = &totals[i];
+        printf("%-8s %14llu %6.1f%% %14u %12llu %12llu\n", g_stageNames[i],
+               (unsigned long long) (total->cycles / count),
+               frameCycles ? 100.0 * total->cycles / frameCycles : 0.0,
+               total->maxCycles,
+               (unsigned long long) (total->dcacheMisses / count),
+               (unsigned long long) (total->branchMispredicts / count));
+    }
+    printf("%-8s %14llu\n", "total",
+           (unsigned long long) (frameCycles / count));
+    return 0;
+}
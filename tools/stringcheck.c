@@ -0,0 +1,101 @@
+// Checks the memcpy() and memset() of string_asm.S against the C library.
+// Built for ARM Linux with the assembly symbols renamed, and run under
+// qemu-arm user mode:
+//
+//   make check-string
+//
+// Covers every source and destination alignment from 0 to 3 with sizes up
+// to STRING_CHECK_SIZES bytes and one large copy, and looks at guard bytes
+// on both sides of the destination. Exits non-zero when a check fails.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void *string_memcpy(void *dst, const void *src, size_t n);
+void *string_memset(void *dst, int c, size_t n);
+
+#define STRING_CHECK_SIZES 300
+#define STRING_CHECK_LARGE (65536 + 13)
+// bytes on either side of the destination that must stay untouched
+#define GUARD_SIZE 16
+#define GUARD_BYTE 0xA5
+#define BUFFER_SIZE (STRING_CHECK_LARGE + 2 * GUARD_SIZE + 8)
+
+static uint8_t s_source[BUFFER_SIZE];
+static uint8_t s_dest[BUFFER_SIZE];
+static uint8_t s_expected[BUFFER_SIZE];
+static unsigned s_failures;
+
+static void Fail(const char *what,
+                 size_t dstAlign,
+                 size_t srcAlign,
+                 size_t size)
+{
+    if (s_failures++ < 20) {
+        fprintf(stderr, "%s failed: dst +%zu, src +%zu, %zu bytes\n", what,
+                dstAlign, srcAlign, size);
+    }
+}
+
+static void CheckCopy(size_t dstAlign, size_t srcAlign, size_t size)
+{
+    uint8_t *dst = s_dest + GUARD_SIZE + dstAlign;
+    const uint8_t *src = s_source + srcAlign;
+
+    memset(s_dest, GUARD_BYTE, sizeof(s_dest));
+    memcpy(s_expected, s_dest, sizeof(s_expected));
+    memcpy(s_expected + GUARD_SIZE + dstAlign, src, size);
+
+    if (string_memcpy(dst, src, size) != dst) {
+        Fail("memcpy return", dstAlign, srcAlign, size);
+    }
+    if (memcmp(s_dest, s_expected, sizeof(s_dest)) != 0) {
+        Fail("memcpy", dstAlign, srcAlign, size);
+    }
+}
+
+static void CheckSet(size_t dstAlign, size_t size, int c)
+{
+    uint8_t *dst = s_dest + GUARD_SIZE + dstAlign;
+
+    memset(s_dest, GUARD_BYTE, sizeof(s_dest));
+    memcpy(s_expected, s_dest, sizeof(s_expected));
+    memset(s_expected + GUARD_SIZE + dstAlign, c, size);
+
+    if (string_memset(dst, c, size) != dst) {
+        Fail("memset return", dstAlign, 0, size);
+    }
+    if (memcmp(s_dest, s_expected, sizeof(s_dest)) != 0) {
+        Fail("memset", dstAlign, 0, size);
+    }
+}
+
+int main(void)
+{
+    srand(1);
+    for (size_t i = 0; i < sizeof(s_source); i++) {
+        s_source[i] = rand();
+    }
+
+    for (size_t dstAlign = 0; dstAlign < 4; dstAlign++) {
+        for (size_t srcAlign = 0; srcAlign < 4; srcAlign++) {
+            for (size_t size = 0; size <= STRING_CHECK_SIZES; size++) {
+                CheckCopy(dstAlign, srcAlign, size);
+            }
+            CheckCopy(dstAlign, srcAlign, STRING_CHECK_LARGE);
+        }
+        for (size_t size = 0; size <= STRING_CHECK_SIZES; size++) {
+            // only the low byte of the value counts
+            CheckSet(dstAlign, size, 0x100 | (int) (size & 0xFF));
+        }
+        CheckSet(dstAlign, STRING_CHECK_LARGE, 0x3C);
+    }
+
+    if (s_failures != 0) {
+        fprintf(stderr, "%u checks failed\n", s_failures);
+        return 1;
+    }
+    printf("memcpy and memset match the C library\n");
+    return 0;
+}
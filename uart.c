@@ -1,7 +1,9 @@
 #include "uart.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include "irq.h"
 #include "mmio.h"
 
 #define GPIO_BASE 0x20200000
@@ -33,6 +35,31 @@
 #define UART_FULL 0x00000020
 #define UART_EMPTY 0x00000010
 
+#define UART_RX_INT (1 << 4)
+#define UART_RT_INT (1 << 6)
+
+// received characters, filled by the interrupt handler and drained by
+// uart_getc; each index has a single writer, so no lock is needed
+#define UART_RING_SIZE 256
+
+static volatile uint8_t g_uartRing[UART_RING_SIZE];
+static volatile uint32_t g_uartHead;
+static volatile uint32_t g_uartTail;
+
+static void uart_irq(void)
+{
+    while (!(mmio_read(UART_FR) & UART_EMPTY)) {
+        const uint8_t c = mmio_read(UART_DR);
+        const uint32_t head = g_uartHead;
+        // drop input nobody reads
+        if (head - g_uartTail < UART_RING_SIZE) {
+            g_uartRing[head % UART_RING_SIZE] = c;
+            g_uartHead = head + 1;
+        }
+    }
+    mmio_write(UART_ICR, UART_RX_INT | UART_RT_INT);
+}
+
 void uart_init(void)
 {
     mmio_write(UART_CR, 0x00000000);
@@ -52,8 +79,10 @@ void uart_init(void)
 
     mmio_write(UART_LCRH, (1 << 4) | (1 << 5) | (1 << 6));
 
-    mmio_write(UART_IMSC, (1 << 1) | (1 << 4) | (1 << 5) | (1 << 6) | (1 << 7) |
-                              (1 << 8) | (1 << 9) | (1 << 10));
+    // interrupt when the receive FIFO is 1/8 full or goes idle
+    mmio_write(UART_IFLS, 0);
+    mmio_write(UART_IMSC, UART_RX_INT | UART_RT_INT);
+    irq_enable(IRQ_UART, uart_irq);
 
     mmio_write(UART_CR, (1 << 0) | (1 << 8) | (1 << 9));
 }
@@ -67,14 +96,17 @@ void uart_putc(char c)
 
 bool uart_empty(void)
 {
-    return mmio_read(UART_FR) & UART_EMPTY;
+    return g_uartHead == g_uartTail;
 }
 
 char uart_getc(void)
 {
-    while (mmio_read(UART_FR) & UART_EMPTY)
+    while (uart_empty())
         ;
-    return mmio_read(UART_DR);
+    const uint32_t tail = g_uartTail;
+    const char c = g_uartRing[tail % UART_RING_SIZE];
+    g_uartTail = tail + 1;
+    return c;
 }
 
 void uart_puts(const char *str)
@@ -82,3 +114,10 @@ void uart_puts(const char *str)
     for (size_t i = 0; str[i] != '\0'; ++i)
         uart_putc(str[i]);
 }
+
+void uart_write(const void *data, size_t size)
+{
+    const char *bytes = data;
+    for (size_t i = 0; i < size; ++i)
+        uart_putc(bytes[i]);
+}
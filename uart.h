@@ -2,15 +2,23 @@
 #define UART_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
+// Needs irq_init first: input is received by the UART interrupt into a ring
+// buffer.
 void uart_init(void);
 
+// True when no received character is waiting.
 bool uart_empty(void);
 
+// Takes the oldest received character, waiting for one if needed.
 char uart_getc(void);
 
 void uart_putc(char c);
 
 void uart_puts(const char *str);
 
+// Sends size raw bytes, eg. binary records for a host tool.
+void uart_write(const void *data, size_t size);
+
 #endif  // UART_H
\ No newline at end of file
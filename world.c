@@ -0,0 +1,149 @@
+#include "world.h"
+
+#include <string.h>
+
+// what non-resident and wall-less chunks read as
+static uint8_t g_solidWalls[WORLD_CHUNK_WALLS];
+static const uint8_t g_emptyWalls[WORLD_CHUNK_WALLS];
+static const uint8_t g_emptyTypes[WORLD_CHUNK_TYPES];
+static const uint8_t g_emptyLight[WORLD_CHUNK_LIGHT];
+
+static void WorldEvict(World *world, int16_t chunk)
+{
+    world->map.walls[chunk] = g_solidWalls;
+    world->map.types[chunk] = g_emptyTypes;
+    world->map.light[chunk] = g_emptyLight;
+}
+
+bool WorldLoad(World *world, const void *data, size_t size)
+{
+    const WorldHeader *header = (const WorldHeader *) data;
+    if (size < sizeof(WorldHeader) || header->magic != WORLD_MAGIC ||
+        header->version != WORLD_VERSION) {
+        return false;
+    }
+    const int chunkCount = header->chunksX * header->chunksY;
+    if (header->chunksX == 0 || header->chunksY == 0 ||
+        header->chunksX > MAP_MAX_SIZE >> MAP_CHUNK_SHIFT ||
+        header->chunksY > MAP_MAX_SIZE >> MAP_CHUNK_SHIFT ||
+        header->spawns == 0 || header->spawn % sizeof(uint16_t) != 0 ||
+        header->spawn > size ||
+        size - header->spawn < header->spawns * sizeof(MapSpawn) ||
+        header->chunks % sizeof(uint32_t) != 0 || header->chunks > size ||
+        size - header->chunks < chunkCount * sizeof(uint32_t)) {
+        return false;
+    }
+    const uint8_t *image = (const uint8_t *) data;
+    if (!MapSpawnsInside((const MapSpawn *) (image + header->spawn),
+                         header->spawns, header->chunksX << MAP_CHUNK_SHIFT,
+                         header->chunksY << MAP_CHUNK_SHIFT)) {
+        return false;
+    }
+    const uint32_t *chunks = (const uint32_t *) (image + header->chunks);
+    for (int i = 0; i < chunkCount; i++) {
+        if (chunks[i] != 0 &&
+            (chunks[i] > size || size - chunks[i] < WORLD_CHUNK_BYTES)) {
+            return false;
+        }
+    }
+
+    memset(g_solidWalls, 0xFF, sizeof(g_solidWalls));
+    Map *map = &world->map;
+    map->width = header->chunksX << MAP_CHUNK_SHIFT;
+    map->height = header->chunksY << MAP_CHUNK_SHIFT;
+    map->chunkShift = MAP_CHUNK_SHIFT;
+    map->chunksX = header->chunksX;
+    map->wallStride = WORLD_CHUNK >> 3;
+    map->typeStride = WORLD_CHUNK >> 1;
+    map->lightStride = WORLD_CHUNK;
+    for (int i = 0; i < chunkCount; i++) {
+        if (chunks[i] == 0) {
+            // nothing to page in
+            map->walls[i] = g_emptyWalls;
+            map->types[i] = g_emptyTypes;
+            map->light[i] = g_emptyLight;
+        } else {
+            WorldEvict(world, i);
+        }
+    }
+    map->distance = NULL;
+    map->spawns = (const MapSpawn *) (image + header->spawn);
+    map->spawnCount = header->spawns;
+    map->mapping = NULL;
+    map->length = 0;
+
+    world->image = image;
+    world->chunks = chunks;
+    world->clock = 0;
+    world->loads = 0;
+    for (int i = 0; i < WORLD_CACHE_SLOTS; i++) {
+        world->slots[i].chunk = -1;
+        world->slots[i].used = 0;
+    }
+    return true;
+}
+
+// Marks the chunk under tile (x, y) as wanted this frame, paging it into
+// the least recently wanted slot if it is not resident.
+static void WorldWant(World *world, int x, int y)
+{
+    Map *map = &world->map;
+    x = MIN(MAX(x, 0), map->width - 1);
+    y = MIN(MAX(y, 0), map->height - 1);
+    const int16_t chunk = MapChunk(map, x, y);
+    if (world->chunks[chunk] == 0) {
+        return;
+    }
+
+    WorldSlot *victim = NULL;
+    for (int i = 0; i < WORLD_CACHE_SLOTS; i++) {
+        WorldSlot *slot = &world->slots[i];
+        if (slot->chunk == chunk) {
+            slot->used = world->clock;
+            return;
+        }
+        if (slot->used != world->clock &&
+            (victim == NULL || slot->chunk < 0 ||
+             (victim->chunk >= 0 && slot->used < victim->used))) {
+            victim = slot;
+        }
+    }
+    if (victim == NULL) {
+        return;
+    }
+
+    if (victim->chunk >= 0) {
+        WorldEvict(world, victim->chunk);
+    }
+    const uint8_t *record = world->image + world->chunks[chunk];
+    memcpy(victim->walls, record, WORLD_CHUNK_WALLS);
+    record += WORLD_CHUNK_WALLS;
+    memcpy(victim->types, record, WORLD_CHUNK_TYPES);
+    record += WORLD_CHUNK_TYPES;
+    memcpy(victim->light, record, WORLD_CHUNK_LIGHT);
+    victim->chunk = chunk;
+    victim->used = world->clock;
+    map->walls[chunk] = victim->walls;
+    map->types[chunk] = victim->types;
+    map->light[chunk] = victim->light;
+    world->loads++;
+}
+
+void WorldUpdate(World *world, const Game *game)
+{
+    world->clock++;
+
+    // the view square spans at most 2x2 chunks
+    const int x = game->playerX >> 8;
+    const int y = game->playerY >> 8;
+    WorldWant(world, x, y);
+    WorldWant(world, x - WORLD_VIEW, y - WORLD_VIEW);
+    WorldWant(world, x + WORLD_VIEW, y - WORLD_VIEW);
+    WorldWant(world, x - WORLD_VIEW, y + WORLD_VIEW);
+    WorldWant(world, x + WORLD_VIEW, y + WORLD_VIEW);
+
+    int16_t sine, cosine;
+    GameDirection(game, &sine, &cosine);
+    WorldWant(world, x + ((sine * WORLD_PREFETCH) >> 8),
+              y + ((cosine * WORLD_PREFETCH) >> 8));
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "map.h"
+
+#define WORLD_MAGIC 0x44575243 // "RCWD"
+#define WORLD_VERSION 1
+
+#define WORLD_CHUNK (1 << MAP_CHUNK_SHIFT)
+#define WORLD_CHUNK_WALLS (WORLD_CHUNK * WORLD_CHUNK / 8)
+#define WORLD_CHUNK_TYPES (WORLD_CHUNK * WORLD_CHUNK / 2)
+#define WORLD_CHUNK_LIGHT (WORLD_CHUNK * WORLD_CHUNK)
+#define WORLD_CHUNK_BYTES \
+    (WORLD_CHUNK_WALLS + WORLD_CHUNK_TYPES + WORLD_CHUNK_LIGHT)
+
+// resident chunks, enough for the view square plus the prefetched chunk
+// and a few recently left behind
+#define WORLD_CACHE_SLOTS 8
+// tiles around the player that are kept resident
+#define WORLD_VIEW 16
+// tiles ahead of the player whose chunk is prefetched
+#define WORLD_PREFETCH 24
+
+// On-disk header of a chunked world, host byte order. Offsets are from the
+// start of the file.
+//   spawn  - MapSpawn[spawns], in 8.8 tiles
+//   chunks - uint32_t[chunksX * chunksY] offsets of the chunk records, row
+//            by row, 0 for a chunk without any walls
+// Every chunk record is WORLD_CHUNK_BYTES: the walls, types and light of a
+// 32x32 tile chunk in the layouts of a map file 32 tiles wide.
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t spawns;
+    uint8_t chunksX;
+    uint8_t chunksY;
+    uint16_t reserved;
+    uint32_t spawn;
+    uint32_t chunks;
+} WorldHeader;
+
+typedef struct {
+    // chunk index or -1 when free
+    int16_t chunk;
+    // WorldUpdate() clock of the last frame it was wanted
+    uint32_t used;
+    uint8_t walls[WORLD_CHUNK_WALLS];
+    uint8_t types[WORLD_CHUNK_TYPES];
+    uint8_t light[WORLD_CHUNK_LIGHT];
+} WorldSlot;
+
+// A map whose chunks are paged in from a world file image around the
+// player. Chunks that are not resident read as solid wall, so rays that
+// reach them end on a far wall and the player cannot walk into them.
+typedef struct {
+    Map map;
+    const uint8_t *image;
+    const uint32_t *chunks;
+    uint32_t clock;
+    // chunks copied in since loading
+    uint32_t loads;
+    WorldSlot slots[WORLD_CACHE_SLOTS];
+} World;
+
+// Points a world at a world file image in memory, with no chunk resident
+// until the first WorldUpdate(). The image must outlive the world.
+bool WorldLoad(World *world, const void *data, size_t size);
+
+// Maps a world file read-only, only available on hosted builds. Release
+// it with MapClose(&world->map).
+bool WorldOpen(World *world, const char *path);
+
+// Makes the chunks around the player and the one ahead of them resident,
+// evicting the least recently wanted ones. Call once per frame before
+// rendering.
+void WorldUpdate(World *world, const Game *game);